@@ -0,0 +1,148 @@
+//=============================================================================
+// DESCRIPTION:
+//    Prints the IR of a function with its live sets as comments, in a single
+//    pass over the function through an AssemblyAnnotationWriter:
+//
+//      bb1:                                    ; preds = %entry
+//      ; live-in: %a %b (2)
+//        %c = add i32 %a, %b                   ; live: %b %c (2)
+//        ...
+//      ; live-out: %c (1)
+//
+//    Values are referred to by name (or slot number), so no instruction is
+//    printed twice. Parameters (comma-separated inside '<...>'):
+//      insts - also annotate every instruction with the values live after it
+//      delta - print changes instead of full sets: '+%c -%a' per instruction
+//              (relative to the previous one) and at the end of the block
+//              (relative to its live-in set)
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    On entering a block, walk it backwards once from its live-out set and
+//    keep the set live after each instruction until the next block
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    Print the live-in set after the block label, the set (or delta) after
+//    each instruction and the live-out set (or delta) after the terminator
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/IR/AssemblyAnnotationWriter.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/Support/FormattedStream.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+// Comments after instructions start at this column, if it is free
+constexpr unsigned CommentColumn = 50;
+
+class LiveSetsAnnotator : public AssemblyAnnotationWriter {
+public:
+    LiveSetsAnnotator(const LiveSets &LS, bool Insts, bool Delta)
+            : LS(LS), MST(LS.getFunction().getParent()), Insts(Insts),
+              Delta(Delta) {
+        MST.incorporateFunction(LS.getFunction());
+    }
+
+    void emitBasicBlockStartAnnot(const BasicBlock *BB,
+                                  formatted_raw_ostream &OS) override {
+        // STEP 1: Sets after every instruction of BB
+        LiveAfter.clear();
+        if (Insts)
+            LS.walkBlockBackward(*BB, [&](const Instruction &I,
+                                          const BitVector &Live) {
+                LiveAfter[&I] = Live;
+            });
+        Prev = LS.getLiveIn(BB);
+
+        // STEP 2: Annotations
+        OS << "; live-in: ";
+        printSet(OS, Prev);
+        OS << "\n";
+    }
+
+    void printInfoComment(const Value &V,
+                          formatted_raw_ostream &OS) override {
+        auto It = LiveAfter.find(dyn_cast<Instruction>(&V));
+        if (It == LiveAfter.end())
+            return;
+        OS.PadToColumn(CommentColumn);
+        if (Delta) {
+            OS << "; ";
+            printDelta(OS, Prev, It->second);
+        } else {
+            OS << "; live: ";
+            printSet(OS, It->second);
+        }
+        Prev = It->second;
+    }
+
+    void emitBasicBlockEndAnnot(const BasicBlock *BB,
+                                formatted_raw_ostream &OS) override {
+        const BitVector &LiveOut = LS.getLiveOut(BB);
+        OS << "; live-out: ";
+        if (Delta)
+            printDelta(OS, LS.getLiveIn(BB), LiveOut);
+        else
+            printSet(OS, LiveOut);
+        OS << "\n";
+    }
+
+private:
+    void printValue(raw_ostream &OS, unsigned Idx) {
+        LS.getValue(Idx)->printAsOperand(OS, false, MST);
+    }
+
+    // The values followed by the register pressure
+    void printSet(raw_ostream &OS, const BitVector &Set) {
+        for (unsigned Idx : Set.set_bits()) {
+            printValue(OS, Idx);
+            OS << " ";
+        }
+        OS << "(" << LS.getPressure(Set) << ")";
+    }
+
+    void printDelta(raw_ostream &OS, const BitVector &From,
+                    const BitVector &To) {
+        bool First = true;
+        auto Print = [&](const BitVector &A, const BitVector &B, char Sign) {
+            for (unsigned Idx : A.set_bits()) {
+                if (B.test(Idx))
+                    continue;
+                if (!First)
+                    OS << " ";
+                First = false;
+                OS << Sign;
+                printValue(OS, Idx);
+            }
+        };
+        Print(To, From, '+');
+        Print(From, To, '-');
+        if (First)
+            OS << "=";
+    }
+
+    const LiveSets &LS;
+    ModuleSlotTracker MST;
+    bool Insts, Delta;
+    DenseMap<const Instruction *, BitVector> LiveAfter;
+    // The set at the previous program point of the current block
+    BitVector Prev;
+};
+} // namespace
+
+PreservedAnalyses LiveIRPrinter::run(Function &F,
+                                     FunctionAnalysisManager &FAM) {
+    LiveSetsAnnotator Annotator(FAM.getResult<LiveSetsAnalysis>(F), Insts,
+                                Delta);
+    F.print(OS, &Annotator);
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
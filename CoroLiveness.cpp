@@ -0,0 +1,270 @@
+//=============================================================================
+// DESCRIPTION:
+//    For every llvm.coro.suspend in a (pre-split) coroutine, reports which
+//    SSA values and allocas are live across the suspend point and the frame
+//    bytes they need, next to an estimate of what CoroSplit would put in the
+//    frame. Values that could be recomputed after resume from other frame
+//    values are highlighted.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    S = a suspend point, BB_S = its block
+//    Across_S = values live on the resume and destroy edges of BB_S
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    For every S compute Across_S from the live sets. An alloca is in
+//    Across_S if a pointer derived from it is.
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    CoroSplit estimate: like CoroSplit's SuspendCrossingInfo (at block
+//    granularity, without kills), v is spilled for S if its definition
+//    reaches BB_S and BB_S reaches one of its uses. Allocas whose address
+//    escapes always go to the frame, the others when BB_S reaches a use of a
+//    pointer derived from them.
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    v in Across_S is recomputable if it is cheap and every operand is a
+//    constant or itself in Across_S
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/Analysis/CaptureTracking.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+// Results of coro.* intrinsics (the frame handle, ids, tokens) are handled
+// by CoroSplit itself and never stored in the frame.
+bool isFrameCandidate(const Value *V) {
+    if (V->getType()->isTokenTy())
+        return false;
+    if (auto *II = dyn_cast<IntrinsicInst>(V))
+        return !II->getCalledFunction()->getName().startswith("llvm.coro.");
+    return true;
+}
+
+// Frame bytes for Set, laid out in ordinal order with natural alignment
+uint64_t getFrameBytes(const LiveSets &LS, const BitVector &Set,
+                       const DataLayout &DL) {
+    uint64_t Offset = 0;
+    for (unsigned Idx : Set.set_bits()) {
+        Value *V = LS.getValue(Idx);
+        uint64_t Size;
+        Align Alignment;
+        if (auto *AI = dyn_cast<AllocaInst>(V)) {
+            Size = DL.getTypeAllocSize(AI->getAllocatedType());
+            if (auto *Count = dyn_cast<ConstantInt>(AI->getArraySize()))
+                Size *= Count->getZExtValue();
+            Alignment = AI->getAlign();
+        } else {
+            Size = DL.getTypeAllocSize(V->getType());
+            Alignment = DL.getABITypeAlign(V->getType());
+        }
+        Offset = alignTo(Offset, Alignment) + Size;
+    }
+    return Offset;
+}
+
+// The alloca and the pointers derived from it through GEPs, casts, phis and
+// selects
+SmallPtrSet<const Value *, 8> getDerivedPointers(const AllocaInst *AI) {
+    SmallPtrSet<const Value *, 8> Derived;
+    SmallVector<const Value *, 8> Worklist{AI};
+    Derived.insert(AI);
+    while (!Worklist.empty()) {
+        const Value *Ptr = Worklist.pop_back_val();
+        for (const User *U : Ptr->users())
+            if ((isa<GetElementPtrInst>(U) || isa<BitCastInst>(U) ||
+                 isa<AddrSpaceCastInst>(U) || isa<PHINode>(U) ||
+                 isa<SelectInst>(U)) &&
+                Derived.insert(U).second)
+                Worklist.push_back(U);
+    }
+    return Derived;
+}
+
+struct SuspendInfo {
+    IntrinsicInst *Suspend;
+    BitVector Across;
+    BitVector CoroSplit;
+    BitVector Recomputable;
+};
+
+// STEP 1: Values live on the edges that resume (or destroy) the coroutine.
+// The default destination of the switch returns to the caller.
+BitVector getLiveAcross(const LiveSets &LS, IntrinsicInst *Suspend) {
+    BitVector Across(LS.getNumValues());
+    auto *Switch = dyn_cast<SwitchInst>(Suspend->getParent()->getTerminator());
+    if (Switch && Switch->getCondition() == Suspend) {
+        for (auto &Case : Switch->cases())
+            Across |= LS.getLiveOnEdge(Switch->getParent(),
+                                       Case.getCaseSuccessor());
+    } else {
+        Across = LS.getLiveAfter(Suspend);
+    }
+    Across.reset(LS.getIndex(Suspend));
+
+    // The memory of an alloca outlives the pointers that are live
+    for (unsigned Idx = 0, E = LS.getNumValues(); Idx != E; ++Idx) {
+        auto *AI = dyn_cast<AllocaInst>(LS.getValue(Idx));
+        if (!AI || Across.test(Idx))
+            continue;
+        for (const Value *Ptr : getDerivedPointers(AI)) {
+            int PtrIdx = LS.getIndex(Ptr);
+            if (PtrIdx >= 0 && Across.test(PtrIdx)) {
+                Across.set(Idx);
+                break;
+            }
+        }
+    }
+    return Across;
+}
+
+// STEP 2: CoroSplit's spill decision, approximated at block granularity
+BitVector getCoroSplitEstimate(const LiveSets &LS, IntrinsicInst *Suspend) {
+    BasicBlock *SuspendBB = Suspend->getParent();
+    SmallPtrSet<const BasicBlock *, 32> ReachesSuspend, ReachedFromSuspend;
+    for (const BasicBlock *BB : inverse_depth_first(SuspendBB))
+        ReachesSuspend.insert(BB);
+    for (const BasicBlock *Succ : successors(SuspendBB))
+        for (const BasicBlock *BB : depth_first(Succ))
+            ReachedFromSuspend.insert(BB);
+
+    auto DefReaches = [&](const Value *V) {
+        auto *Def = dyn_cast<Instruction>(V);
+        if (!Def)
+            return true;
+        if (Def->getParent() == SuspendBB)
+            return Def->comesBefore(Suspend) ||
+                   ReachedFromSuspend.count(SuspendBB);
+        return ReachesSuspend.count(Def->getParent()) != 0;
+    };
+    auto UseReached = [&](const Use &U) {
+        auto *User = cast<Instruction>(U.getUser());
+        const BasicBlock *UseBB = User->getParent();
+        if (auto *Phi = dyn_cast<PHINode>(User))
+            UseBB = Phi->getIncomingBlock(U);
+        else if (UseBB == SuspendBB && Suspend->comesBefore(User))
+            return true;
+        return ReachedFromSuspend.count(UseBB) != 0;
+    };
+
+    BitVector Spilled(LS.getNumValues());
+    for (unsigned Idx = 0, E = LS.getNumValues(); Idx != E; ++Idx) {
+        Value *V = LS.getValue(Idx);
+        if (V == Suspend || !isFrameCandidate(V) || !DefReaches(V))
+            continue;
+        if (auto *AI = dyn_cast<AllocaInst>(V)) {
+            if (PointerMayBeCaptured(AI, /*ReturnCaptures=*/true,
+                                     /*StoreCaptures=*/true) ||
+                any_of(getDerivedPointers(AI), [&](const Value *Ptr) {
+                    return any_of(Ptr->uses(), UseReached);
+                }))
+                Spilled.set(Idx);
+            continue;
+        }
+        if (any_of(V->uses(), UseReached))
+            Spilled.set(Idx);
+    }
+    return Spilled;
+}
+
+// STEP 3: Values that can be rebuilt from the rest of the frame
+BitVector getRecomputable(const LiveSets &LS, const BitVector &Across) {
+    BitVector Recomputable(LS.getNumValues());
+    for (unsigned Idx : Across.set_bits()) {
+        auto *Inst = dyn_cast<Instruction>(LS.getValue(Idx));
+        if (!Inst || isa<AllocaInst>(Inst) || !isCheapToRecompute(Inst))
+            continue;
+        bool Available = all_of(Inst->operands(), [&](const Value *Op) {
+            int OpIdx = LS.getIndex(Op);
+            return OpIdx < 0 || Across.test(OpIdx);
+        });
+        if (Available)
+            Recomputable.set(Idx);
+    }
+    return Recomputable;
+}
+} // namespace
+
+PreservedAnalyses CoroLivenessPass::run(Function &F,
+                                        FunctionAnalysisManager &FAM) {
+    SmallVector<IntrinsicInst *, 4> Suspends;
+    for (BasicBlock &BB : F)
+        for (Instruction &Inst : BB)
+            if (auto *II = dyn_cast<IntrinsicInst>(&Inst))
+                if (II->getIntrinsicID() == Intrinsic::coro_suspend)
+                    Suspends.push_back(II);
+    if (Suspends.empty())
+        return PreservedAnalyses::all();
+
+    auto &LS = FAM.getResult<LiveSetsAnalysis>(F);
+    const DataLayout &DL = F.getParent()->getDataLayout();
+
+    BitVector FrameMask(LS.getNumValues());
+    for (unsigned Idx = 0, E = LS.getNumValues(); Idx != E; ++Idx)
+        if (isFrameCandidate(LS.getValue(Idx)))
+            FrameMask.set(Idx);
+
+    std::vector<SuspendInfo> Infos;
+    BitVector FrameUnion(LS.getNumValues()), CoroSplitUnion(LS.getNumValues());
+    for (IntrinsicInst *Suspend : Suspends) {
+        SuspendInfo Info{Suspend, getLiveAcross(LS, Suspend),
+                         getCoroSplitEstimate(LS, Suspend), BitVector()};
+        Info.Across &= FrameMask;
+        Info.Recomputable = getRecomputable(LS, Info.Across);
+        FrameUnion |= Info.Across;
+        CoroSplitUnion |= Info.CoroSplit;
+        Infos.push_back(std::move(Info));
+    }
+
+    raw_ostream &OutS = errs();
+    OutS << "=================================================\n";
+    OutS << "Coroutine frame liveness for function " << F.getName() << "\n";
+    OutS << "=================================================\n";
+    for (auto const &Info : Infos) {
+        std::string DummyStr;
+        raw_string_ostream SuspendStr(DummyStr);
+        Info.Suspend->printAsOperand(SuspendStr, false);
+        SuspendStr << " in block ";
+        Info.Suspend->getParent()->printAsOperand(SuspendStr, false);
+        OutS << format("[[Suspend %s]]\n", SuspendStr.str().c_str());
+        OutS << format("live across: %u values, %llu bytes "
+                       "(CoroSplit: %u values, %llu bytes)\n",
+                       Info.Across.count(),
+                       (unsigned long long)getFrameBytes(LS, Info.Across, DL),
+                       Info.CoroSplit.count(),
+                       (unsigned long long)getFrameBytes(LS, Info.CoroSplit,
+                                                         DL));
+        // Recomputable values are marked with '=>*'
+        for (unsigned Idx : Info.Across.set_bits()) {
+            std::string DummyStr;
+            raw_string_ostream InstrStr(DummyStr);
+            LS.getValue(Idx)->print(InstrStr);
+            const char *Marker = Info.Recomputable.test(Idx) ? "=>*" : "==>";
+            OutS << format("%s%s\n", Marker, InstrStr.str().c_str());
+        }
+        BitVector Kept = Info.Across;
+        Kept.reset(Info.Recomputable);
+        OutS << format("recomputable after resume: %u values, frame %llu "
+                       "bytes without them\n",
+                       Info.Recomputable.count(),
+                       (unsigned long long)getFrameBytes(LS, Kept, DL));
+        OutS << "-------------------------------------------------\n";
+    }
+    OutS << format("Frame: %llu bytes (CoroSplit: %llu bytes)\n\n",
+                   (unsigned long long)getFrameBytes(LS, FrameUnion, DL),
+                   (unsigned long long)getFrameBytes(LS, CoroSplitUnion, DL));
+
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
@@ -0,0 +1,197 @@
+//=============================================================================
+// DESCRIPTION:
+//    Sinks definitions towards their uses when that shortens live ranges:
+//    a value computed early but only used in a distant (e.g. cold) block
+//    occupies a register on every path in between. The pass moves it to the
+//    nearest common dominator of its uses and updates the cached LiveSets
+//    for the moved value and its operands only.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    Target_I = nearest common dominator of the blocks using I (for a phi
+//               use, the incoming block), hoisted out of any loop that does
+//               not contain I
+//    Cost_I   = register operands of I that are not live-in to Target_I,
+//               i.e. whose live ranges sinking I would extend. An operand
+//               used only by I that can be sunk along with it counts as
+//               its own Cost instead.
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Visit the blocks in post order of the dominator tree and every block
+//    bottom-up, so users are sunk before the definitions they use
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    Skip phis, terminators, EH pads, allocas and instructions that touch
+//    memory or have side effects. Sink I if Target_I differs from its block
+//    and Cost_I is 0 (I, and the operands following it, no longer cross
+//    the blocks in between while no other value starts to)
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Move I before its first user in Target_I (or to the first insertion
+//    point) and update the live sets of I and of each of its operands
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+bool canSink(const Instruction &I) {
+    return !isa<PHINode>(I) && !I.isTerminator() && !I.isEHPad() &&
+           !isa<AllocaInst>(I) && !I.getType()->isTokenTy() &&
+           !I.mayReadOrWriteMemory() && !I.mayHaveSideEffects() &&
+           !I.use_empty();
+}
+
+// The block to sink I to, or nullptr
+BasicBlock *getTarget(Instruction &I, DominatorTree &DT, LoopInfo &LI) {
+    BasicBlock *DefBB = I.getParent();
+    BasicBlock *Target = nullptr;
+    for (Use &U : I.uses()) {
+        auto *User = cast<Instruction>(U.getUser());
+        BasicBlock *UseBB = User->getParent();
+        if (auto *Phi = dyn_cast<PHINode>(User))
+            UseBB = Phi->getIncomingBlock(U);
+        Target = Target ? DT.findNearestCommonDominator(Target, UseBB) : UseBB;
+        if (Target == DefBB)
+            return nullptr;
+    }
+    // Never sink into a loop
+    for (Loop *L = LI.getLoopFor(Target); L && !L->contains(DefBB);
+         L = LI.getLoopFor(Target))
+        Target = DT.getNode(Target)->getIDom()->getBlock();
+    if (Target == DefBB || Target->getFirstInsertionPt() == Target->end())
+        return nullptr;
+    return Target;
+}
+
+// Operands of I whose live ranges sinking I to Target would extend. An
+// operand only used by I that can follow it there does not count, its own
+// operands do.
+unsigned getCost(const Instruction &I, const BasicBlock *Target,
+                 const LiveSets &LS, LoopInfo &LI) {
+    const BitVector &RegMask = LS.getRegisterMask();
+    const BitVector &TargetIn = LS.getLiveIn(Target);
+    unsigned Cost = 0;
+    SmallPtrSet<const Value *, 4> Seen;
+    for (const Value *Op : I.operands()) {
+        int Idx = LS.getIndex(Op);
+        if (Idx < 0 || !RegMask.test(Idx) || TargetIn.test(Idx) ||
+            !Seen.insert(Op).second)
+            continue;
+        auto *OpInst = dyn_cast<Instruction>(Op);
+        const Loop *L = LI.getLoopFor(Target);
+        if (OpInst && OpInst->hasOneUse() && canSink(*OpInst) &&
+            (!L || L->contains(OpInst)))
+            Cost += getCost(*OpInst, Target, LS, LI);
+        else
+            ++Cost;
+    }
+    return Cost;
+}
+
+// The first user of I in BB, or BB's first insertion point
+Instruction *getInsertPoint(Instruction &I, BasicBlock &BB) {
+    SmallPtrSet<const Instruction *, 8> Users;
+    for (User *U : I.users())
+        if (!isa<PHINode>(U))
+            Users.insert(cast<Instruction>(U));
+    for (Instruction &Inst : BB)
+        if (Users.count(&Inst))
+            return &Inst;
+    return &*BB.getFirstInsertionPt();
+}
+
+unsigned getPeakPressure(const LiveSets &LS) {
+    unsigned Peak = 0;
+    for (const BasicBlock &BB : LS.getFunction())
+        Peak = std::max(Peak, LS.getMaxPressure(&BB));
+    return Peak;
+}
+
+unsigned getNumLiveIn(const LiveSets &LS) {
+    unsigned Count = 0;
+    for (const BasicBlock &BB : LS.getFunction())
+        Count += LS.getPressure(LS.getLiveIn(&BB));
+    return Count;
+}
+} // namespace
+
+PreservedAnalyses DefinitionSinkingPass::run(Function &F,
+                                             FunctionAnalysisManager &FAM) {
+    auto &DT = FAM.getResult<DominatorTreeAnalysis>(F);
+    auto &LI = FAM.getResult<LoopAnalysis>(F);
+    LiveSets &LS = FAM.getResult<LiveSetsAnalysis>(F);
+    const BitVector &RegMask = LS.getRegisterMask();
+
+    raw_ostream &OutS = errs();
+    OutS << "=================================================\n";
+    OutS << "Definition sinking for function " << F.getName() << "\n";
+    OutS << "=================================================\n";
+
+    unsigned PeakBefore = getPeakPressure(LS);
+    unsigned LiveInBefore = getNumLiveIn(LS);
+    unsigned Sunk = 0;
+
+    // STEP 1: Users first
+    for (DomTreeNode *Node : post_order(DT.getRootNode())) {
+        BasicBlock *BB = Node->getBlock();
+        for (auto It = BB->rbegin(); It != BB->rend();) {
+            Instruction &I = *It++;
+
+            // STEP 2: Is sinking I worth it?
+            int Idx = LS.getIndex(&I);
+            if (!canSink(I) || Idx < 0 || !RegMask.test(Idx))
+                continue;
+            BasicBlock *Target = getTarget(I, DT, LI);
+            if (!Target)
+                continue;
+            if (getCost(I, Target, LS, LI))
+                continue;
+
+            // STEP 3: Move it and update the sets it affects
+            std::string DummyStr;
+            raw_string_ostream InstrStr(DummyStr);
+            I.print(InstrStr);
+            std::string FromStr, ToStr;
+            raw_string_ostream FromStream(FromStr), ToStream(ToStr);
+            BB->printAsOperand(FromStream, false);
+            Target->printAsOperand(ToStream, false);
+            OutS << format("==>%s\n", InstrStr.str().c_str());
+            OutS << format("   %s -> %s\n", FromStream.str().c_str(),
+                           ToStream.str().c_str());
+
+            I.moveBefore(getInsertPoint(I, *Target));
+            LS.updateValue(&I);
+            for (const Value *Op : I.operands())
+                LS.updateValue(Op);
+            ++Sunk;
+        }
+    }
+
+    OutS << format("sunk %u definitions, peak pressure %u -> %u, live-in "
+                   "values %u -> %u\n",
+                   Sunk, PeakBefore, getPeakPressure(LS), LiveInBefore,
+                   getNumLiveIn(LS));
+    if (Verify)
+        OutS << (LS.isEquivalentTo(LiveSets(F)) ? "live sets verified\n"
+                                                 : "LIVE SETS DIFFER\n");
+    OutS << "-------------------------------------------------\n\n";
+
+    if (!Sunk)
+        return PreservedAnalyses::all();
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    PA.preserve<LiveSetsAnalysis>();
+    return PA;
+}
+
+} // namespace liveness
@@ -0,0 +1,295 @@
+//=============================================================================
+// DESCRIPTION:
+//    Field-sensitive liveness for allocas of aggregate type. Every top-level
+//    field of a struct (or element of an array) is a separate location; a
+//    field is live at a point if some path from it loads the field before
+//    the field is completely overwritten. For every such alloca the pass
+//    reports the live range of each field (the blocks it is live in), the
+//    peak number of live bytes, and the stack bytes that splitting the
+//    alloca into its fields would save.
+//
+//    Allocas whose address escapes (passed to a call, stored, compared, ...)
+//    are reported as such and not split.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Follow the uses of the alloca through constant-offset GEPs and casts.
+//    Every load, store and memory intrinsic becomes a (Reads, Kills) pair of
+//    field sets; accesses at unknown offsets read every field and kill none.
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    Solve backward liveness over the fields:
+//      LiveOut_N = U LiveIn_S  (S in successors of N)
+//      LiveIn_N  = Reads_N U (LiveOut_N - Kills_N)
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Walk every block backwards to record where each field is live and the
+//    peak of the sum of the live field sizes. Splitting saves the size of
+//    the alloca minus that peak.
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <deque>
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+// Arrays with more elements than this are not split
+constexpr unsigned MaxFields = 64;
+
+struct Field {
+    uint64_t Offset;
+    uint64_t Size;
+};
+
+struct FieldAccess {
+    BitVector Reads;
+    BitVector Kills;
+};
+
+struct AllocaFields {
+    AllocaInst *AI;
+    std::vector<Field> Fields;
+    MapVector<const Instruction *, FieldAccess> Accesses;
+    bool Escapes = false;
+};
+
+bool getFields(AllocaInst *AI, const DataLayout &DL,
+               std::vector<Field> &Fields) {
+    if (!AI->isStaticAlloca() || AI->isArrayAllocation())
+        return false;
+    Type *Ty = AI->getAllocatedType();
+    if (auto *STy = dyn_cast<StructType>(Ty)) {
+        const StructLayout *SL = DL.getStructLayout(STy);
+        for (unsigned I = 0, E = STy->getNumElements(); I != E; ++I)
+            Fields.push_back({SL->getElementOffset(I),
+                              DL.getTypeStoreSize(STy->getElementType(I))});
+    } else if (auto *ATy = dyn_cast<ArrayType>(Ty)) {
+        if (ATy->getNumElements() > MaxFields)
+            return false;
+        uint64_t Stride = DL.getTypeAllocSize(ATy->getElementType());
+        uint64_t Size = DL.getTypeStoreSize(ATy->getElementType());
+        for (uint64_t I = 0, E = ATy->getNumElements(); I != E; ++I)
+            Fields.push_back({I * Stride, Size});
+    }
+    return Fields.size() > 1;
+}
+
+// STEP 1: Field accesses of one alloca
+void collectAccesses(AllocaFields &A, const DataLayout &DL) {
+    unsigned NumFields = A.Fields.size();
+    unsigned PtrBits = DL.getIndexTypeSizeInBits(A.AI->getType());
+
+    // Fields overlapping [Offset, Offset + Size), or all of them if the
+    // offset or the size is unknown. Only fully covered fields are killed.
+    auto AddAccess = [&](const Instruction *I, Optional<int64_t> Offset,
+                         Optional<uint64_t> Size, bool IsWrite) {
+        FieldAccess &Acc = A.Accesses[I];
+        if (Acc.Reads.empty()) {
+            Acc.Reads = BitVector(NumFields);
+            Acc.Kills = BitVector(NumFields);
+        }
+        for (unsigned F = 0; F != NumFields; ++F) {
+            const Field &Fld = A.Fields[F];
+            if (!Offset || !Size) {
+                if (!IsWrite)
+                    Acc.Reads.set(F);
+                continue;
+            }
+            int64_t Begin = *Offset, End = *Offset + int64_t(*Size);
+            int64_t FBegin = Fld.Offset, FEnd = Fld.Offset + Fld.Size;
+            if (End <= FBegin || FEnd <= Begin)
+                continue;
+            if (!IsWrite)
+                Acc.Reads.set(F);
+            else if (Begin <= FBegin && FEnd <= End)
+                Acc.Kills.set(F);
+        }
+    };
+
+    SmallVector<std::pair<const Value *, Optional<int64_t>>, 8> Worklist;
+    Worklist.push_back({A.AI, int64_t(0)});
+    while (!Worklist.empty() && !A.Escapes) {
+        const Value *Ptr = Worklist.back().first;
+        Optional<int64_t> Offset = Worklist.back().second;
+        Worklist.pop_back();
+        for (const Use &U : Ptr->uses()) {
+            auto *User = cast<Instruction>(U.getUser());
+            if (auto *GEP = dyn_cast<GetElementPtrInst>(User)) {
+                APInt GEPOffset(PtrBits, 0);
+                if (Offset && GEP->accumulateConstantOffset(DL, GEPOffset))
+                    Worklist.push_back(
+                            {GEP, *Offset + GEPOffset.getSExtValue()});
+                else
+                    Worklist.push_back({GEP, None});
+            } else if (isa<BitCastInst>(User) ||
+                       isa<AddrSpaceCastInst>(User)) {
+                Worklist.push_back({User, Offset});
+            } else if (auto *LI = dyn_cast<LoadInst>(User)) {
+                AddAccess(LI, Offset,
+                          DL.getTypeStoreSize(LI->getType()).getFixedSize(),
+                          false);
+            } else if (auto *SI = dyn_cast<StoreInst>(User)) {
+                if (U.getOperandNo() != SI->getPointerOperandIndex()) {
+                    A.Escapes = true;
+                    break;
+                }
+                Type *ValTy = SI->getValueOperand()->getType();
+                AddAccess(SI, Offset,
+                          DL.getTypeStoreSize(ValTy).getFixedSize(), true);
+            } else if (User->isLifetimeStartOrEnd()) {
+                // The contents are undefined outside the lifetime markers
+                Type *AllocTy = A.AI->getAllocatedType();
+                AddAccess(User, int64_t(0),
+                          DL.getTypeStoreSize(AllocTy).getFixedSize(), true);
+            } else if (auto *MI = dyn_cast<MemIntrinsic>(User)) {
+                Optional<uint64_t> Size;
+                if (auto *Len = dyn_cast<ConstantInt>(MI->getLength()))
+                    Size = Len->getZExtValue();
+                if (U.getOperandNo() == 0)
+                    AddAccess(MI, Offset, Size, true);
+                else
+                    AddAccess(MI, Offset, Size, false);
+            } else {
+                A.Escapes = true;
+                break;
+            }
+        }
+    }
+}
+
+// Backward transfer of the accesses of BB from Live
+void transferBlock(const AllocaFields &A, const BasicBlock &BB,
+                   BitVector &Live,
+                   function_ref<void(const BitVector &)> Visit) {
+    for (const Instruction &I : reverse(BB)) {
+        auto It = A.Accesses.find(&I);
+        if (It == A.Accesses.end())
+            continue;
+        Live.reset(It->second.Kills);
+        Live |= It->second.Reads;
+        Visit(Live);
+    }
+}
+
+uint64_t getLiveBytes(const AllocaFields &A, const BitVector &Live) {
+    uint64_t Bytes = 0;
+    for (unsigned F : Live.set_bits())
+        Bytes += A.Fields[F].Size;
+    return Bytes;
+}
+} // namespace
+
+PreservedAnalyses FieldLivenessPass::run(Function &F,
+                                         FunctionAnalysisManager &) {
+    const DataLayout &DL = F.getParent()->getDataLayout();
+    std::vector<AllocaFields> Allocas;
+    for (Instruction &I : F.getEntryBlock())
+        if (auto *AI = dyn_cast<AllocaInst>(&I)) {
+            AllocaFields A;
+            A.AI = AI;
+            if (!getFields(AI, DL, A.Fields))
+                continue;
+            collectAccesses(A, DL);
+            Allocas.push_back(std::move(A));
+        }
+    if (Allocas.empty())
+        return PreservedAnalyses::all();
+
+    raw_ostream &OutS = errs();
+    OutS << "=================================================\n";
+    OutS << "Field liveness for function " << F.getName() << "\n";
+    OutS << "=================================================\n";
+    uint64_t TotalSaved = 0;
+    for (const AllocaFields &A : Allocas) {
+        std::string DummyStr;
+        raw_string_ostream AllocaStr(DummyStr);
+        A.AI->printAsOperand(AllocaStr, false);
+        uint64_t AllocSize = DL.getTypeAllocSize(A.AI->getAllocatedType());
+        if (A.Escapes) {
+            OutS << format("[[Alloca %s]] %llu bytes, %u fields, escapes\n",
+                           AllocaStr.str().c_str(),
+                           (unsigned long long)AllocSize,
+                           static_cast<unsigned>(A.Fields.size()));
+            OutS << "-------------------------------------------------\n";
+            continue;
+        }
+
+        // STEP 2: Backward dataflow over the fields
+        unsigned NumFields = A.Fields.size();
+        DenseMap<const BasicBlock *, BitVector> LiveIn;
+        for (const BasicBlock &BB : F)
+            LiveIn[&BB] = BitVector(NumFields);
+        auto LiveOutOf = [&](const BasicBlock &BB) {
+            BitVector Out(NumFields);
+            for (const BasicBlock *Succ : successors(&BB))
+                Out |= LiveIn[Succ];
+            return Out;
+        };
+        std::deque<const BasicBlock *> Worklist;
+        for (const BasicBlock &BB : F)
+            Worklist.push_front(&BB);
+        while (!Worklist.empty()) {
+            const BasicBlock *BB = Worklist.front();
+            Worklist.pop_front();
+            BitVector Live = LiveOutOf(*BB);
+            transferBlock(A, *BB, Live, [](const BitVector &) {});
+            if (Live == LiveIn[BB])
+                continue;
+            LiveIn[BB] = std::move(Live);
+            for (const BasicBlock *Pred : predecessors(BB))
+                Worklist.push_back(Pred);
+        }
+
+        // STEP 3: Live ranges and peak live bytes
+        std::vector<SmallVector<const BasicBlock *, 8>> Ranges(NumFields);
+        uint64_t Peak = 0;
+        for (const BasicBlock &BB : F) {
+            BitVector Live = LiveOutOf(BB);
+            BitVector LiveInBB = Live;
+            Peak = std::max(Peak, getLiveBytes(A, Live));
+            transferBlock(A, BB, Live, [&](const BitVector &Before) {
+                LiveInBB |= Before;
+                Peak = std::max(Peak, getLiveBytes(A, Before));
+            });
+            for (unsigned Fld : LiveInBB.set_bits())
+                Ranges[Fld].push_back(&BB);
+        }
+
+        uint64_t Saved = AllocSize - Peak;
+        TotalSaved += Saved;
+        OutS << format("[[Alloca %s]] %llu bytes, %u fields, peak live %llu "
+                       "bytes, splitting saves %llu bytes\n",
+                       AllocaStr.str().c_str(), (unsigned long long)AllocSize,
+                       NumFields, (unsigned long long)Peak,
+                       (unsigned long long)Saved);
+        for (unsigned Fld = 0; Fld != NumFields; ++Fld) {
+            OutS << format("==>field %u (offset %llu, %llu bytes):", Fld,
+                           (unsigned long long)A.Fields[Fld].Offset,
+                           (unsigned long long)A.Fields[Fld].Size);
+            if (Ranges[Fld].empty())
+                OutS << " never live";
+            for (const BasicBlock *BB : Ranges[Fld]) {
+                OutS << " ";
+                BB->printAsOperand(OutS, false);
+            }
+            OutS << "\n";
+        }
+        OutS << "-------------------------------------------------\n";
+    }
+    OutS << format("Splitting saves %llu stack bytes\n\n",
+                   (unsigned long long)TotalSaved);
+
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
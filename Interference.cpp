@@ -0,0 +1,151 @@
+//=============================================================================
+// DESCRIPTION:
+//    Implementation of InterferenceQuery (see Liveness.h) and of its
+//    printer, 'print<interference>'.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    STEP 1 (construction, linear in the size of F):
+//    For every tracked value record its definition point: the DFS interval
+//    of its block in the dominator tree and its position in the block. For
+//    every non-phi use record the last position at which the value is used
+//    in the user's block.
+//    -------------------------------------------------------------------------
+//    STEP 2 (query, constant time):
+//    A dominates B iff BB_A == BB_B ? Pos_A < Pos_B : DFS(BB_A) contains
+//    DFS(BB_B). A is live right after B iff A is live-out of BB_B or A is
+//    used later in BB_B.
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+InterferenceQuery::InterferenceQuery(const LiveSets &LS, DominatorTree &DT)
+        : LS(LS), Defs(LS.getNumValues()) {
+    DT.updateDFSNumbers();
+    Function &F = LS.getFunction();
+
+    // STEP 1: Definition points and last uses
+    auto SetBlock = [&](DefPoint &Def, const BasicBlock *BB) {
+        Def.BB = BB;
+        if (const DomTreeNode *Node = DT.getNode(BB)) {
+            Def.Reachable = true;
+            Def.DFSIn = Node->getDFSNumIn();
+            Def.DFSOut = Node->getDFSNumOut();
+        }
+    };
+    for (Argument &Arg : F.args()) {
+        int Idx = LS.getIndex(&Arg);
+        if (Idx >= 0)
+            SetBlock(Defs[Idx], &F.getEntryBlock());
+    }
+    for (BasicBlock &BB : F) {
+        unsigned Pos = 0;
+        for (Instruction &Inst : BB) {
+            if (!isa<PHINode>(Inst)) {
+                ++Pos;
+                for (const Value *Op : Inst.operands()) {
+                    int OpIdx = LS.getIndex(Op);
+                    if (OpIdx >= 0)
+                        LastUse[{static_cast<unsigned>(OpIdx), &BB}] = Pos;
+                }
+            }
+            int Idx = LS.getIndex(&Inst);
+            if (Idx < 0)
+                continue;
+            SetBlock(Defs[Idx], &BB);
+            Defs[Idx].Pos = Pos;
+        }
+    }
+}
+
+// STEP 2: Queries
+bool InterferenceQuery::dominates(const DefPoint &A,
+                                  const DefPoint &B) const {
+    if (A.BB == B.BB)
+        return A.Pos < B.Pos;
+    return A.DFSIn <= B.DFSIn && B.DFSOut <= A.DFSOut;
+}
+
+bool InterferenceQuery::isLiveAt(int IdxA, const DefPoint &B) const {
+    if (LS.getLiveOut(B.BB).test(IdxA))
+        return true;
+    auto It = LastUse.find({static_cast<unsigned>(IdxA), B.BB});
+    return It != LastUse.end() && It->second > B.Pos;
+}
+
+bool InterferenceQuery::interfere(int IdxA, int IdxB) const {
+    if (IdxA == IdxB)
+        return false;
+    const DefPoint &A = Defs[IdxA], &B = Defs[IdxB];
+    if (!A.Reachable || !B.Reachable)
+        return false;
+    // Arguments and phis of one block are all defined at its top
+    if (A.BB == B.BB && A.Pos == B.Pos)
+        return isLiveAt(IdxA, B) || isLiveAt(IdxB, A);
+    if (dominates(A, B))
+        return isLiveAt(IdxA, B);
+    if (dominates(B, A))
+        return isLiveAt(IdxB, A);
+    return false;
+}
+
+bool InterferenceQuery::interfere(const Value *A, const Value *B) const {
+    int IdxA = LS.getIndex(A), IdxB = LS.getIndex(B);
+    return IdxA >= 0 && IdxB >= 0 && interfere(IdxA, IdxB);
+}
+
+const Value *
+InterferenceQuery::findInterference(const Value *V,
+                                    ArrayRef<const Value *> Class) const {
+    int Idx = LS.getIndex(V);
+    if (Idx < 0)
+        return nullptr;
+    for (const Value *Member : Class) {
+        int MemberIdx = LS.getIndex(Member);
+        if (MemberIdx >= 0 && interfere(Idx, MemberIdx))
+            return Member;
+    }
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Printer pass
+//-----------------------------------------------------------------------------
+PreservedAnalyses InterferencePrinter::run(Function &F,
+                                           FunctionAnalysisManager &FAM) {
+    const LiveSets &LS = FAM.getResult<LiveSetsAnalysis>(F);
+    InterferenceQuery IQ(LS, FAM.getResult<DominatorTreeAnalysis>(F));
+
+    OS << "=================================================\n";
+    OS << "Interference for function " << F.getName() << "\n";
+    OS << "=================================================\n";
+    SmallVector<const Value *, 16> Earlier;
+    for (unsigned Idx = 0, E = LS.getNumValues(); Idx != E; ++Idx) {
+        const Value *V = LS.getValue(Idx);
+        V->printAsOperand(OS, false);
+        OS << ":";
+        for (const Value *Other : Earlier)
+            if (IQ.interfere(V, Other)) {
+                OS << " ";
+                Other->printAsOperand(OS, false);
+            }
+        if (const Value *First = IQ.findInterference(V, Earlier)) {
+            OS << " (first ";
+            First->printAsOperand(OS, false);
+            OS << ")";
+        }
+        OS << "\n";
+        Earlier.push_back(V);
+    }
+    OS << "-------------------------------------------------\n";
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
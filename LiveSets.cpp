@@ -0,0 +1,439 @@
+//=============================================================================
+// DESCRIPTION:
+//    Implementation of LiveSets (see Liveness.h), the analysis wrapper used by
+//    the new pass manager and the 'print<live-sets>' printer pass.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Number the arguments and value-producing instructions of F
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    For every BB_N in F compute Defs_N, UpwardExposed_N and the phi operands
+//    PhiUses_{S <- N} flowing into each successor S
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Iterate the backward equations over a worklist seeded in post order
+//    until no LiveIn set changes (the region engine replaces this step, see
+//    RegionLiveness.cpp, and sets attached as metadata make it unnecessary,
+//    see LivenessMetadata.cpp)
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <deque>
+
+using namespace llvm;
+
+namespace liveness {
+
+bool needsRegister(const Value *V) {
+    if (auto *AI = dyn_cast<AllocaInst>(V))
+        if (AI->isStaticAlloca())
+            return false;
+    Type *Ty = V->getType();
+    return !Ty->isTokenTy() && !Ty->isLabelTy() && !Ty->isMetadataTy();
+}
+
+//-----------------------------------------------------------------------------
+// LiveSets Implementation
+//-----------------------------------------------------------------------------
+LiveSets::LiveSets(Function &F) : F(&F) {
+    numberValues();
+    LocalMapTy Local = computeLocalSets();
+
+    // Seeding the worklist in post order means that successors are (mostly)
+    // visited before their predecessors. Unreachable blocks go last.
+    std::vector<const BasicBlock *> Order;
+    SmallPtrSet<const BasicBlock *, 32> Seen;
+    for (const BasicBlock *BB : post_order(&F.getEntryBlock())) {
+        Order.push_back(BB);
+        Seen.insert(BB);
+    }
+    for (const BasicBlock &BB : F)
+        if (Seen.insert(&BB).second)
+            Order.push_back(&BB);
+    solveFlat(Order, Local);
+}
+
+// STEP 1: Number the values that can be live
+void LiveSets::numberValues() {
+    for (Argument &Arg : F->args())
+        if (Arg.getType()->isFirstClassType()) {
+            Index[&Arg] = Values.size();
+            Values.push_back(&Arg);
+        }
+    for (Instruction &Inst : instructions(*F))
+        if (!Inst.getType()->isVoidTy()) {
+            Index[&Inst] = Values.size();
+            Values.push_back(&Inst);
+        }
+
+    RegMask.resize(Values.size());
+    for (unsigned Idx = 0, E = Values.size(); Idx != E; ++Idx)
+        if (needsRegister(Values[Idx]))
+            RegMask.set(Idx);
+}
+
+// STEP 2: Local information for every block. This also creates the (empty)
+// result sets of every block, so the engines never insert into Blocks.
+LiveSets::LocalMapTy LiveSets::computeLocalSets() {
+    unsigned NumValues = Values.size();
+    LocalMapTy Local;
+    for (BasicBlock &BB : *F) {
+        BitVector Defs(NumValues), UpExposed(NumValues);
+        for (Instruction &Inst : BB) {
+            if (auto *Phi = dyn_cast<PHINode>(&Inst)) {
+                for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E;
+                     ++I) {
+                    int Idx = getIndex(Phi->getIncomingValue(I));
+                    if (Idx < 0)
+                        continue;
+                    auto &Uses = PhiUses[{Phi->getIncomingBlock(I), &BB}];
+                    if (Uses.empty())
+                        Uses.resize(NumValues);
+                    Uses.set(Idx);
+                }
+            } else {
+                for (Value *Op : Inst.operands()) {
+                    int Idx = getIndex(Op);
+                    if (Idx >= 0 && !Defs.test(Idx))
+                        UpExposed.set(Idx);
+                }
+            }
+            int Idx = getIndex(&Inst);
+            if (Idx >= 0)
+                Defs.set(Idx);
+        }
+        Local[&BB] = {std::move(Defs), std::move(UpExposed)};
+        auto &Sets = Blocks[&BB];
+        Sets.LiveIn.resize(NumValues);
+        Sets.LiveOut.resize(NumValues);
+    }
+    return Local;
+}
+
+// STEP 3: Iterate to a fixed point, starting from the blocks in Order.
+// Blocks outside Order are only revisited if a successor changes.
+void LiveSets::solveFlat(ArrayRef<const BasicBlock *> Order,
+                         const LocalMapTy &Local) {
+    std::deque<const BasicBlock *> Worklist(Order.begin(), Order.end());
+    SmallPtrSet<const BasicBlock *, 32> InWorklist;
+    InWorklist.insert(Order.begin(), Order.end());
+
+    while (!Worklist.empty()) {
+        const BasicBlock *BB = Worklist.front();
+        Worklist.pop_front();
+        InWorklist.erase(BB);
+
+        auto &Sets = Blocks.find(BB)->second;
+        for (const BasicBlock *Succ : successors(BB)) {
+            Sets.LiveOut |= Blocks.find(Succ)->second.LiveIn;
+            auto It = PhiUses.find({BB, Succ});
+            if (It != PhiUses.end())
+                Sets.LiveOut |= It->second;
+        }
+
+        auto &L = Local.find(BB)->second;
+        BitVector NewIn = Sets.LiveOut;
+        NewIn.reset(L.Defs);
+        NewIn |= L.UpExposed;
+        if (NewIn == Sets.LiveIn)
+            continue;
+
+        Sets.LiveIn = std::move(NewIn);
+        for (const BasicBlock *Pred : predecessors(BB))
+            if (InWorklist.insert(Pred).second)
+                Worklist.push_back(Pred);
+    }
+}
+
+int LiveSets::getIndex(const Value *V) const {
+    auto It = Index.find(V);
+    return It == Index.end() ? -1 : static_cast<int>(It->second);
+}
+
+const BitVector &LiveSets::getLiveIn(const BasicBlock *BB) const {
+    return Blocks.find(BB)->second.LiveIn;
+}
+
+const BitVector &LiveSets::getLiveOut(const BasicBlock *BB) const {
+    return Blocks.find(BB)->second.LiveOut;
+}
+
+bool LiveSets::isLiveIn(const Value *V, const BasicBlock *BB) const {
+    int Idx = getIndex(V);
+    return Idx >= 0 && getLiveIn(BB).test(Idx);
+}
+
+bool LiveSets::isLiveOut(const Value *V, const BasicBlock *BB) const {
+    int Idx = getIndex(V);
+    return Idx >= 0 && getLiveOut(BB).test(Idx);
+}
+
+BitVector LiveSets::getLiveOnEdge(const BasicBlock *From,
+                                  const BasicBlock *To) const {
+    BitVector Live = getLiveIn(To);
+    auto It = PhiUses.find({From, To});
+    if (It != PhiUses.end())
+        Live |= It->second;
+    return Live;
+}
+
+void LiveSets::walkBlockBackward(
+        const BasicBlock &BB,
+        function_ref<void(const Instruction &, const BitVector &)> Fn) const {
+    BitVector Live = getLiveOut(&BB);
+    for (const Instruction &Inst : reverse(BB)) {
+        Fn(Inst, Live);
+        int Idx = getIndex(&Inst);
+        if (Idx >= 0)
+            Live.reset(Idx);
+        if (isa<PHINode>(Inst))
+            continue;
+        for (const Value *Op : Inst.operands()) {
+            int OpIdx = getIndex(Op);
+            if (OpIdx >= 0)
+                Live.set(OpIdx);
+        }
+    }
+}
+
+BitVector LiveSets::getLiveAfter(const Instruction *I) const {
+    BitVector Result;
+    bool Found = false;
+    walkBlockBackward(*I->getParent(),
+                      [&](const Instruction &Inst, const BitVector &Live) {
+                          if (!Found && &Inst == I) {
+                              Result = Live;
+                              Found = true;
+                          }
+                      });
+    return Result;
+}
+
+BitVector LiveSets::getLiveBefore(const Instruction *I) const {
+    BitVector Live = getLiveAfter(I);
+    int Idx = getIndex(I);
+    if (Idx >= 0)
+        Live.reset(Idx);
+    if (!isa<PHINode>(I))
+        for (const Value *Op : I->operands()) {
+            int OpIdx = getIndex(Op);
+            if (OpIdx >= 0)
+                Live.set(OpIdx);
+        }
+    return Live;
+}
+
+unsigned LiveSets::getPressure(const BitVector &Live) const {
+    BitVector Masked = Live;
+    Masked &= RegMask;
+    return Masked.count();
+}
+
+unsigned LiveSets::getMaxPressure(const BasicBlock *BB) const {
+    unsigned Max = getPressure(getLiveIn(BB));
+    walkBlockBackward(*BB, [&](const Instruction &, const BitVector &Live) {
+        Max = std::max(Max, getPressure(Live));
+    });
+    return Max;
+}
+
+bool LiveSets::isSameAs(const LiveSets &Other) const {
+    if (Values != Other.Values)
+        return false;
+    for (const BasicBlock &BB : *F)
+        if (getLiveIn(&BB) != Other.getLiveIn(&BB) ||
+            getLiveOut(&BB) != Other.getLiveOut(&BB))
+            return false;
+    return true;
+}
+
+bool LiveSets::isEquivalentTo(const LiveSets &Other) const {
+    auto Same = [&](const BitVector &Set, const BitVector &OtherSet) {
+        if (Set.count() != OtherSet.count())
+            return false;
+        for (unsigned Idx : Set.set_bits()) {
+            int OtherIdx = Other.getIndex(getValue(Idx));
+            if (OtherIdx < 0 || !OtherSet.test(OtherIdx))
+                return false;
+        }
+        return true;
+    };
+    for (const BasicBlock &BB : *F)
+        if (!Same(getLiveIn(&BB), Other.getLiveIn(&BB)) ||
+            !Same(getLiveOut(&BB), Other.getLiveOut(&BB)))
+            return false;
+    return true;
+}
+
+void computeLiveInBlocks(ArrayRef<const BasicBlock *> UseBlocks,
+                         const SmallPtrSetImpl<const BasicBlock *> &DefBlocks,
+                         SmallPtrSetImpl<const BasicBlock *> &LiveIn) {
+    SmallVector<const BasicBlock *, 16> Worklist;
+    for (const BasicBlock *BB : UseBlocks)
+        if (LiveIn.insert(BB).second)
+            Worklist.push_back(BB);
+    while (!Worklist.empty()) {
+        const BasicBlock *BB = Worklist.pop_back_val();
+        for (const BasicBlock *Pred : predecessors(BB))
+            if (!DefBlocks.count(Pred) && LiveIn.insert(Pred).second)
+                Worklist.push_back(Pred);
+    }
+}
+
+void LiveSets::updateValue(const Value *V) {
+    int Idx = getIndex(V);
+    if (Idx < 0)
+        return;
+    for (auto &KV : Blocks) {
+        KV.second.LiveIn.reset(Idx);
+        KV.second.LiveOut.reset(Idx);
+    }
+
+    // Arguments are defined above the entry block. A phi use is a use at
+    // the end of the incoming block.
+    SmallPtrSet<const BasicBlock *, 1> DefBlocks;
+    if (auto *Def = dyn_cast<Instruction>(V))
+        DefBlocks.insert(Def->getParent());
+    SmallVector<const BasicBlock *, 8> UseBlocks;
+    for (const Use &U : V->uses()) {
+        auto *User = dyn_cast<Instruction>(U.getUser());
+        if (!User)
+            continue;
+        const BasicBlock *UseBB = User->getParent();
+        if (auto *Phi = dyn_cast<PHINode>(User)) {
+            UseBB = Phi->getIncomingBlock(U);
+            Blocks.find(UseBB)->second.LiveOut.set(Idx);
+        }
+        if (!DefBlocks.count(UseBB))
+            UseBlocks.push_back(UseBB);
+    }
+
+    SmallPtrSet<const BasicBlock *, 32> LiveInBlocks;
+    computeLiveInBlocks(UseBlocks, DefBlocks, LiveInBlocks);
+    for (const BasicBlock *BB : LiveInBlocks) {
+        Blocks.find(BB)->second.LiveIn.set(Idx);
+        for (const BasicBlock *Pred : predecessors(BB))
+            Blocks.find(Pred)->second.LiveOut.set(Idx);
+    }
+}
+
+void LiveSets::printSet(raw_ostream &OS, const BitVector &Set) const {
+    bool First = true;
+    for (unsigned Idx : Set.set_bits()) {
+        if (!First)
+            OS << " ";
+        First = false;
+        Values[Idx]->printAsOperand(OS, false);
+    }
+}
+
+void LiveSets::print(raw_ostream &OS) const {
+    OS << "=================================================\n";
+    OS << "Live sets for function " << F->getName() << "\n";
+    OS << "=================================================\n";
+    for (const BasicBlock &BB : *F) {
+        OS << "[[BasicBlock ";
+        BB.printAsOperand(OS, false);
+        OS << "]] max pressure " << getMaxPressure(&BB) << "\n";
+        OS << "  live-in:  ";
+        printSet(OS, getLiveIn(&BB));
+        OS << "\n  live-out: ";
+        printSet(OS, getLiveOut(&BB));
+        OS << "\n";
+    }
+    OS << "-------------------------------------------------\n";
+}
+
+//-----------------------------------------------------------------------------
+// Analysis and printer passes
+//-----------------------------------------------------------------------------
+AnalysisKey LiveSetsAnalysis::Key;
+
+LiveSets LiveSetsAnalysis::run(Function &F, FunctionAnalysisManager &) {
+    // Sets attached by 'attach-liveness' are reused while F is unchanged
+    Optional<LiveSets> Loaded = LiveSets::loadMetadata(F);
+    if (Loaded)
+        return std::move(*Loaded);
+    return LiveSets(F);
+}
+
+PreservedAnalyses LiveSetsPrinter::run(Function &F,
+                                       FunctionAnalysisManager &FAM) {
+    FAM.getResult<LiveSetsAnalysis>(F).print(OS);
+    return PreservedAnalyses::all();
+}
+
+//-----------------------------------------------------------------------------
+// PassOptions Implementation
+//-----------------------------------------------------------------------------
+bool PassOptions::parse(StringRef Name, StringRef PassName,
+                        ArrayRef<StringRef> Keys) {
+    Opts.clear();
+    Invalid = false;
+    if (!Name.consume_front(PassName))
+        return false;
+    this->PassName = PassName.str();
+    if (Name.empty())
+        return true;
+    if (!Name.consume_front("<") || !Name.consume_back(">"))
+        return false;
+
+    SmallVector<StringRef, 4> Params;
+    Name.split(Params, ';', -1, false);
+    for (StringRef Param : Params) {
+        StringRef Key, Val;
+        std::tie(Key, Val) = Param.split('=');
+        Key = Key.trim();
+        if (!is_contained(Keys, Key))
+            invalid("unknown pass parameter '" + Key + "'");
+        Opts[Key] = Val.trim().str();
+    }
+    return true;
+}
+
+StringRef PassOptions::getString(StringRef Key, StringRef Default) const {
+    auto It = Opts.find(Key);
+    return It == Opts.end() ? Default : StringRef(It->second);
+}
+
+unsigned PassOptions::getUnsigned(StringRef Key, unsigned Default) {
+    auto It = Opts.find(Key);
+    if (It == Opts.end())
+        return Default;
+    unsigned Val;
+    if (StringRef(It->second).getAsInteger(0, Val)) {
+        invalid("invalid value for pass parameter '" + Key + "': " +
+                It->second);
+        return Default;
+    }
+    return Val;
+}
+
+double PassOptions::getDouble(StringRef Key, double Default) {
+    auto It = Opts.find(Key);
+    if (It == Opts.end())
+        return Default;
+    double Val;
+    if (StringRef(It->second).getAsDouble(Val)) {
+        invalid("invalid value for pass parameter '" + Key + "': " +
+                It->second);
+        return Default;
+    }
+    return Val;
+}
+
+bool PassOptions::invalid(const Twine &Msg) {
+    errs() << PassName << ": " << Msg << "\n";
+    Invalid = true;
+    return false;
+}
+
+} // namespace liveness
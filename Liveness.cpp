@@ -23,34 +23,67 @@
 //=============================================================================
 
 
+#include "Liveness.h"
+
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
+#include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
 #include "llvm/IR/Dominators.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/ValueMap.h"
+#include "llvm/Support/Compression.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/TimeProfiler.h"
 
 
 using namespace llvm;
 
 namespace {
-    using Result = llvm::MapVector<llvm::BasicBlock const *, llvm::SmallPtrSet<llvm::Value *, 8>>;
+    using Result = liveness::RIVResult;
 
-    void printRIVResult(raw_ostream &OutS, const Result &resultMap) {
+    void printRIVResult(raw_ostream &OutS, const Result &resultMap,
+                        bool Approximate = false) {
+        TimeTraceScope TraceScope("RIV printing");
         OutS << "=================================================\n";
-        OutS << "Reachable Value analysis results\n";
+        OutS << (Approximate ? "Reachable Value analysis results "
+                               "(approximate)\n"
+                             : "Reachable Value analysis results\n");
         OutS << "=================================================\n";
 
         const char *Str1 = "BB id";
         const char *Str2 = "Reachable Values";
         const char *EmptyStr = "";
 
+        // Values are printed in IR order (globals, arguments, instructions)
+        // rather than in the pointer order of the sets, so that the output is
+        // deterministic
+        DenseMap<const Value *, unsigned> Order;
+        if (!resultMap.empty()) {
+            const Function *F = resultMap.front().first->getParent();
+            for (auto &Global : F->getParent()->getGlobalList())
+                Order.insert({&Global, Order.size()});
+            for (auto &Arg : F->args())
+                Order.insert({&Arg, Order.size()});
+            for (auto &Inst : instructions(F))
+                Order.insert({&Inst, Order.size()});
+        }
+
         for (auto const &KV : resultMap) {
             std::string DummyStr;
             raw_string_ostream BBIdStream(DummyStr);
             KV.first->printAsOperand(BBIdStream, false);
             OutS << format("[[BasicBlock %s]]\n", BBIdStream.str().c_str());
-            for (auto const &Value : KV.second) {
+            SmallVector<Value *, 8> Values(KV.second.begin(), KV.second.end());
+            llvm::sort(Values, [&](const Value *A, const Value *B) {
+                return Order.lookup(A) < Order.lookup(B);
+            });
+            for (auto const &Value : Values) {
                 std::string DummyStr;
                 raw_string_ostream InstrStr(DummyStr);
 
@@ -74,6 +107,9 @@ namespace {
 // RIV Implementation
 //-----------------------------------------------------------------------------
     Result buildRIV(Function &F, NodeTy CFGRoot) {
+        // Phases show up as spans with '-time-trace' (also on the worker
+        // threads of 'liveness-dump')
+        TimeTraceScope TraceScope("RIV", F.getName());
         Result ResultMap;
 
         // Initialise a double-ended queue that will be used to traverse all BBs in F
@@ -83,26 +119,33 @@ namespace {
         // STEP 1: For every basic block BB compute the set of values defined
         // in BB
         DefValMapTy DefinedValuesMap;
-        for (BasicBlock &BB : F) {
-            auto &Values = DefinedValuesMap[&BB];
-            for (Instruction &Inst : BB)
-                if (Inst.getType()->isFirstClassType())
-                    Values.insert(&Inst);
+        {
+            TimeTraceScope PhaseScope("RIV defs");
+            for (BasicBlock &BB : F) {
+                auto &Values = DefinedValuesMap[&BB];
+                for (Instruction &Inst : BB)
+                    if (Inst.getType()->isFirstClassType())
+                        Values.insert(&Inst);
+            }
         }
 
         // STEP 2: Compute the RIVs for the entry BB. This will include global
         // variables and input arguments.
-        auto &EntryBBValues = ResultMap[&F.getEntryBlock()];
+        {
+            TimeTraceScope PhaseScope("RIV entry");
+            auto &EntryBBValues = ResultMap[&F.getEntryBlock()];
 
-        for (auto &Global : F.getParent()->getGlobalList())
-            if (Global.getValueType()->isFirstClassType())
-                EntryBBValues.insert(&Global);
+            for (auto &Global : F.getParent()->getGlobalList())
+                if (Global.getValueType()->isFirstClassType())
+                    EntryBBValues.insert(&Global);
 
-        for (Argument &Arg : F.args())
-            if (Arg.getType()->isFirstClassType())
-                EntryBBValues.insert(&Arg);
+            for (Argument &Arg : F.args())
+                if (Arg.getType()->isFirstClassType())
+                    EntryBBValues.insert(&Arg);
+        }
 
         // STEP 3: Traverse the CFG for every BB in F calculate its RIVs
+        TimeTraceScope PhaseScope("RIV propagation");
         while (!BBsToProcess.empty()) {
             auto *Parent = BBsToProcess.back();
             BBsToProcess.pop_back();
@@ -132,11 +175,47 @@ namespace {
         return ResultMap;
     }
 
+    // Approximate RIV without a dominator tree, for functions where the
+    // exact result is not worth its cost. A block's unique predecessor
+    // always dominates it, so it stands in for the immediate dominator; a
+    // block with several predecessors falls back to the entry block, which
+    // dominates every block, and gets the entry's RIV and definitions. The
+    // result is a subset of the exact RIV and equal to it when every join
+    // block's idom is the entry.
+    Result buildRIVApprox(Function &F) {
+        TimeTraceScope TraceScope("RIV approx", F.getName());
+        Result ResultMap;
+        BasicBlock *Entry = &F.getEntryBlock();
+        auto &EntryBBValues = ResultMap[Entry];
+        for (auto &Global : F.getParent()->getGlobalList())
+            if (Global.getValueType()->isFirstClassType())
+                EntryBBValues.insert(&Global);
+        for (Argument &Arg : F.args())
+            if (Arg.getType()->isFirstClassType())
+                EntryBBValues.insert(&Arg);
+
+        // In depth-first order a unique predecessor is visited first
+        for (BasicBlock *BB : depth_first(Entry)) {
+            if (BB == Entry)
+                continue;
+            BasicBlock *Idom = BB->getUniquePredecessor();
+            if (!Idom)
+                Idom = Entry;
+            llvm::SmallPtrSet<llvm::Value *, 8> RIVs = ResultMap[Idom];
+            for (Instruction &Inst : *Idom)
+                if (Inst.getType()->isFirstClassType())
+                    RIVs.insert(&Inst);
+            ResultMap[BB] = std::move(RIVs);
+        }
+        return ResultMap;
+    }
+
 
     struct Liveness : PassInfoMixin<Liveness> {
         // Main entry point, takes IR unit to run the liveness on (&F) and the
         // corresponding liveness manager (to be queried if need be)
         PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &FAM) {
+            TimeTraceScope TraceScope("liveness", F.getName());
             DominatorTree *DT = &FAM.getResult<DominatorTreeAnalysis>(F);
             Result Res = buildRIV(F, DT->getRootNode());
 
@@ -146,14 +225,332 @@ namespace {
         }
     };
 
+//-----------------------------------------------------------------------------
+// Compressed output
+//-----------------------------------------------------------------------------
+    enum class Compression { None, Zlib, Zstd };
+
+    // Returns why Kind cannot be used with this LLVM build, or nullptr
+    const char *getCompressionError(Compression Kind) {
+#if LLVM_VERSION_MAJOR >= 16
+        if (Kind == Compression::Zlib)
+            return compression::getReasonIfUnsupported(
+                    compression::Format::Zlib);
+        if (Kind == Compression::Zstd)
+            return compression::getReasonIfUnsupported(
+                    compression::Format::Zstd);
+#elif LLVM_VERSION_MAJOR == 15
+        if (Kind == Compression::Zlib && !compression::zlib::isAvailable())
+            return "LLVM was not built with zlib support";
+        if (Kind == Compression::Zstd && !compression::zstd::isAvailable())
+            return "LLVM was not built with zstd support";
+#else
+        if (Kind == Compression::Zlib && !zlib::isAvailable())
+            return "LLVM was not built with zlib support";
+        if (Kind == Compression::Zstd)
+            return "zstd compression needs LLVM 15 or later";
+#endif
+        return nullptr;
+    }
+
+    void compressChunk(Compression Kind, StringRef In,
+                       SmallVectorImpl<char> &Out) {
+#if LLVM_VERSION_MAJOR >= 15
+        SmallVector<uint8_t, 0> Bytes;
+#if LLVM_VERSION_MAJOR >= 16
+        compression::compress(compression::Params(
+                                      Kind == Compression::Zstd
+                                              ? compression::Format::Zstd
+                                              : compression::Format::Zlib),
+                              arrayRefFromStringRef(In), Bytes);
+#else
+        if (Kind == Compression::Zstd)
+            compression::zstd::compress(arrayRefFromStringRef(In), Bytes);
+        else
+            compression::zlib::compress(arrayRefFromStringRef(In), Bytes);
+#endif
+        Out.assign(Bytes.begin(), Bytes.end());
+#else
+        assert(Kind == Compression::Zlib && "zstd is not available");
+        if (Error E = zlib::compress(In, Out))
+            report_fatal_error(std::move(E), false);
+#endif
+    }
+
+    // Compresses everything written to it in independent chunks of ChunkSize
+    // bytes, so at most one chunk is held in memory. The result is the
+    // concatenation of the compressed chunks: a regular zstd stream, or a
+    // sequence of zlib streams.
+    class CompressedOStream : public raw_ostream {
+    public:
+        CompressedOStream(std::unique_ptr<raw_ostream> Inner, Compression Kind,
+                          size_t ChunkSize)
+                : Inner(std::move(Inner)), Kind(Kind), ChunkSize(ChunkSize) {
+            Chunk.reserve(ChunkSize);
+        }
+        ~CompressedOStream() override {
+            flush();
+            emitChunk();
+        }
+
+    private:
+        void write_impl(const char *Ptr, size_t Size) override {
+            Pos += Size;
+            while (Size) {
+                size_t N = std::min(Size, ChunkSize - Chunk.size());
+                Chunk.append(Ptr, Ptr + N);
+                Ptr += N;
+                Size -= N;
+                if (Chunk.size() == ChunkSize)
+                    emitChunk();
+            }
+        }
+        uint64_t current_pos() const override { return Pos; }
+
+        void emitChunk() {
+            if (Chunk.empty())
+                return;
+            SmallVector<char, 0> Compressed;
+            compressChunk(Kind, StringRef(Chunk.data(), Chunk.size()),
+                          Compressed);
+            Inner->write(Compressed.data(), Compressed.size());
+            Chunk.clear();
+        }
+
+        std::unique_ptr<raw_ostream> Inner;
+        Compression Kind;
+        size_t ChunkSize;
+        SmallVector<char, 0> Chunk;
+        uint64_t Pos = 0;
+    };
+
+//-----------------------------------------------------------------------------
+// Module-wide RIV dump
+//-----------------------------------------------------------------------------
+// Formats the RIV results of a window of functions in parallel, each into its
+// own buffer, and writes the buffers in module order, so the output is the
+// same as running 'liveness' on every function. With Shard != 0 every Shard
+// functions go to a separate file "<Output>.<N>", listed in "<Output>.index".
+// Output files (not the index) are compressed if Compress is set.
+//
+// With a profile (ProfileSummaryInfo and function entry counts), functions
+// whose entry is not hot are skipped (ProfileMode::HotOnly) or get the
+// approximate RIV (ProfileMode::Approximate). Without a profile summary every
+// function is analysed.
+//
+// When opt runs with '-time-trace', every worker thread records its own lane
+// of spans (events shorter than TraceGranularity microseconds are dropped)
+// and hands it over to the main profiler when the pool is done.
+    enum class ProfileMode { None, HotOnly, Approximate };
+
+    // The profiler of a worker thread, set up by the first task the thread
+    // runs and finished when the thread exits, i.e. when the pool is
+    // destroyed
+    struct WorkerTrace {
+        explicit WorkerTrace(unsigned Granularity)
+                : Owned(!getTimeTraceProfilerInstance()) {
+            if (Owned)
+                timeTraceProfilerInitialize(Granularity, "liveness-dump");
+        }
+        ~WorkerTrace() {
+            if (Owned)
+                timeTraceProfilerFinishThread();
+        }
+        // False on the main thread (a pool without threads runs the tasks
+        // there), which keeps the profiler opt set up
+        bool Owned;
+    };
+
+    struct LivenessDump : PassInfoMixin<LivenessDump> {
+        LivenessDump(unsigned Threads, std::string Output, unsigned Shard,
+                     Compression Compress, size_t ChunkSize,
+                     ProfileMode Profile, unsigned TraceGranularity)
+                : Threads(Threads), Output(std::move(Output)), Shard(Shard),
+                  Compress(Compress), ChunkSize(ChunkSize), Profile(Profile),
+                  TraceGranularity(TraceGranularity) {}
+
+        PreservedAnalyses run(Module &M, ModuleAnalysisManager &MAM) {
+            ProfileSummaryInfo *PSI = nullptr;
+            if (Profile != ProfileMode::None) {
+                PSI = &MAM.getResult<ProfileSummaryAnalysis>(M);
+                if (!PSI->hasProfileSummary()) {
+                    errs() << "liveness-dump: no profile summary, analysing "
+                              "every function\n";
+                    PSI = nullptr;
+                }
+            }
+
+            std::vector<Function *> Funcs;
+            // Functions that get the approximate RIV
+            std::vector<bool> Approx;
+            unsigned NumHot = 0, NumSkipped = 0;
+            for (Function &F : M) {
+                if (F.isDeclaration())
+                    continue;
+                bool Hot = !PSI || PSI->isFunctionEntryHot(&F);
+                NumHot += Hot;
+                if (!Hot && Profile == ProfileMode::HotOnly) {
+                    ++NumSkipped;
+                    continue;
+                }
+                Funcs.push_back(&F);
+                Approx.push_back(!Hot);
+            }
+
+            // The profiler is per thread, only the main one is set up by opt
+            bool Trace = timeTraceProfilerEnabled();
+
+            ThreadPoolStrategy Strategy = hardware_concurrency(Threads);
+            ThreadPool Pool(Strategy);
+            // Bounds the memory held by buffers that are not written yet
+            size_t Window = 16 * Strategy.compute_thread_count();
+
+            std::unique_ptr<raw_ostream> File, Index;
+            raw_ostream *OutS = &errs();
+            if (Shard)
+                Index = openFile(Output + ".index");
+            else if (Output != "-")
+                OutS = (File = openOutput(Output)).get();
+
+            std::vector<std::string> Buffers;
+            for (size_t Begin = 0; Begin < Funcs.size(); Begin += Window) {
+                size_t End = std::min(Begin + Window, Funcs.size());
+                Buffers.assign(End - Begin, std::string());
+                for (size_t I = Begin; I != End; ++I)
+                    Pool.async([&, I] {
+                        if (Trace) {
+                            thread_local WorkerTrace PerThread(
+                                    TraceGranularity);
+                            (void)PerThread;
+                        }
+                        // The dominator tree is built locally, the analysis
+                        // manager is not thread-safe
+                        Function &F = *Funcs[I];
+                        TimeTraceScope TraceScope("liveness-dump function",
+                                                  F.getName());
+                        raw_string_ostream BufS(Buffers[I - Begin]);
+                        if (Approx[I]) {
+                            printRIVResult(BufS, buildRIVApprox(F), true);
+                            return;
+                        }
+                        DominatorTree DT(F);
+                        printRIVResult(BufS, buildRIV(F, DT.getRootNode()));
+                    });
+                Pool.wait();
+
+                for (size_t I = Begin; I != End; ++I) {
+                    if (Shard && I % Shard == 0) {
+                        std::string Name = Output + "." + utostr(I / Shard);
+                        File = openOutput(Name);
+                        OutS = File.get();
+                        *Index << Name << ": " << Funcs[I]->getName() << " .. "
+                               << Funcs[std::min(I + Shard, Funcs.size()) - 1]
+                                          ->getName()
+                               << "\n";
+                    }
+                    *OutS << Buffers[I - Begin];
+                }
+            }
+
+            if (PSI)
+                errs() << format("liveness-dump: %u hot functions, %u "
+                                 "approximated, %u skipped\n",
+                                 NumHot,
+                                 static_cast<unsigned>(Funcs.size() - NumHot),
+                                 NumSkipped);
+            return PreservedAnalyses::all();
+        }
+
+    private:
+        static std::unique_ptr<raw_ostream> openFile(const std::string &Name) {
+            std::error_code EC;
+            auto File = std::make_unique<raw_fd_ostream>(Name, EC,
+                                                         sys::fs::OF_None);
+            if (EC)
+                report_fatal_error(Twine("cannot open '") + Name + "': " +
+                                   EC.message(), false);
+            return File;
+        }
+
+        std::unique_ptr<raw_ostream> openOutput(const std::string &Name) const {
+            if (Compress == Compression::None)
+                return openFile(Name);
+            return std::make_unique<CompressedOStream>(openFile(Name), Compress,
+                                                       ChunkSize);
+        }
+
+        unsigned Threads;
+        std::string Output;
+        unsigned Shard;
+        Compression Compress;
+        size_t ChunkSize;
+        ProfileMode Profile;
+        unsigned TraceGranularity;
+    };
+
 } // namespace
 
+//-----------------------------------------------------------------------------
+// RIV interface
+//-----------------------------------------------------------------------------
+namespace liveness {
+
+RIVResult buildRIV(Function &F, DominatorTree &DT) {
+    return ::buildRIV(F, DT.getRootNode());
+}
+
+void printRIV(raw_ostream &OS, const RIVResult &Result) {
+    printRIVResult(OS, Result);
+}
+
+RIVResult buildRIVReference(Function &F, DominatorTree &DT) {
+    RIVResult ResultMap;
+    for (BasicBlock &BB : F) {
+        if (!DT.isReachableFromEntry(&BB))
+            continue;
+        auto &Values = ResultMap[&BB];
+        for (auto &Global : F.getParent()->getGlobalList())
+            if (Global.getValueType()->isFirstClassType())
+                Values.insert(&Global);
+        for (Argument &Arg : F.args())
+            if (Arg.getType()->isFirstClassType())
+                Values.insert(&Arg);
+        for (BasicBlock &Other : F)
+            if (&Other != &BB && DT.dominates(&Other, &BB))
+                for (Instruction &Inst : Other)
+                    if (Inst.getType()->isFirstClassType())
+                        Values.insert(&Inst);
+    }
+    return ResultMap;
+}
+
+bool isSameRIV(const RIVResult &A, const RIVResult &B) {
+    if (A.size() != B.size())
+        return false;
+    for (auto const &KV : A) {
+        auto It = B.find(KV.first);
+        if (It == B.end() || It->second.size() != KV.second.size())
+            return false;
+        for (Value *V : KV.second)
+            if (!It->second.count(V))
+                return false;
+    }
+    return true;
+}
+
+} // namespace liveness
+
 //-----------------------------------------------------------------------------
 // New PM Registration
 //-----------------------------------------------------------------------------
 llvm::PassPluginLibraryInfo getLivenessPluginInfo() {
     return {LLVM_PLUGIN_API_VERSION, "Liveness", LLVM_VERSION_STRING,
             [](PassBuilder &PB) {
+                PB.registerAnalysisRegistrationCallback(
+                        [](FunctionAnalysisManager &FAM) {
+                            FAM.registerPass(
+                                    [] { return liveness::LiveSetsAnalysis(); });
+                        });
                 PB.registerPipelineParsingCallback(
                         [](StringRef Name, FunctionPassManager &FPM,
                            ArrayRef<PassBuilder::PipelineElement>) {
@@ -161,6 +558,195 @@ llvm::PassPluginLibraryInfo getLivenessPluginInfo() {
                                 FPM.addPass(Liveness());
                                 return true;
                             }
+                            if (Name == "print<live-sets>") {
+                                FPM.addPass(liveness::LiveSetsPrinter(errs()));
+                                return true;
+                            }
+                            if (Name == "print<interference>") {
+                                FPM.addPass(
+                                        liveness::InterferencePrinter(errs()));
+                                return true;
+                            }
+                            if (Name == "call-crossing") {
+                                FPM.addPass(liveness::CallCrossingPass());
+                                return true;
+                            }
+                            if (Name == "coro-liveness") {
+                                FPM.addPass(liveness::CoroLivenessPass());
+                                return true;
+                            }
+                            if (Name == "field-liveness") {
+                                FPM.addPass(liveness::FieldLivenessPass());
+                                return true;
+                            }
+                            if (Name == "phi-copies") {
+                                FPM.addPass(liveness::PhiCopiesPass());
+                                return true;
+                            }
+                            if (Name == "promote-allocas") {
+                                FPM.addPass(liveness::PromoteAllocasPass());
+                                return true;
+                            }
+                            liveness::PassOptions Opts;
+                            if (Opts.parse(Name, "print-live-ir",
+                                           {"insts", "delta"})) {
+                                FPM.addPass(liveness::LiveIRPrinter(
+                                        errs(), Opts.hasFlag("insts"),
+                                        Opts.hasFlag("delta")));
+                                return Opts.valid();
+                            }
+                            if (Opts.parse(Name, "attach-liveness",
+                                           {"verify"})) {
+                                FPM.addPass(liveness::AttachLivenessPass(
+                                        Opts.hasFlag("verify")));
+                                return Opts.valid();
+                            }
+                            if (Opts.parse(Name, "sink-defs", {"verify"})) {
+                                FPM.addPass(liveness::DefinitionSinkingPass(
+                                        Opts.hasFlag("verify")));
+                                return Opts.valid();
+                            }
+                            if (Opts.parse(Name, "live-sets-bench",
+                                           {"threads", "repeat"})) {
+                                FPM.addPass(liveness::LiveSetsBenchPass(
+                                        Opts.getUnsigned("threads", 0),
+                                        Opts.getUnsigned("repeat", 1)));
+                                return Opts.valid();
+                            }
+                            if (Opts.parse(Name, "pressure-sched",
+                                           {"verify"})) {
+                                FPM.addPass(liveness::PressureSchedPass(
+                                        Opts.hasFlag("verify")));
+                                return Opts.valid();
+                            }
+                            if (Opts.parse(Name, "remat-candidates",
+                                           {"budget"})) {
+                                FPM.addPass(liveness::RematCandidatesPass(
+                                        Opts.getUnsigned("budget", 16)));
+                                return Opts.valid();
+                            }
+                            if (Opts.parse(Name, "memory-liveness",
+                                           {"threads"})) {
+                                FPM.addPass(liveness::MemoryLivenessPass(
+                                        Opts.getUnsigned("threads", 0)));
+                                return Opts.valid();
+                            }
+                            if (Opts.parse(Name, "vector-lanes", {"width"})) {
+                                unsigned Width = Opts.getUnsigned("width", 128);
+                                if (!Width)
+                                    return Opts.invalid("width must be "
+                                                        "non-zero");
+                                FPM.addPass(liveness::VectorLanesPass(Width));
+                                return Opts.valid();
+                            }
+                            return false;
+                        });
+                PB.registerPipelineParsingCallback(
+                        [](StringRef Name, ModulePassManager &MPM,
+                           ArrayRef<PassBuilder::PipelineElement>) {
+                            liveness::PassOptions Opts;
+                            if (Opts.parse(Name, "liveness-dump",
+                                           {"threads", "output", "shard",
+                                            "compress", "chunk", "profile",
+                                            "trace-granularity"})) {
+                                StringRef Kind = Opts.getString("compress",
+                                                                "none");
+                                Compression Compress =
+                                        StringSwitch<Compression>(Kind)
+                                                .Case("zlib", Compression::Zlib)
+                                                .Case("zstd", Compression::Zstd)
+                                                .Default(Compression::None);
+                                if (Compress == Compression::None &&
+                                    Kind != "none")
+                                    return Opts.invalid(
+                                            "invalid value for pass parameter "
+                                            "'compress': " + Kind);
+                                if (const char *Err =
+                                            getCompressionError(Compress))
+                                    return Opts.invalid(Err);
+                                StringRef Output =
+                                        Opts.getString("output", "-");
+                                if (Compress != Compression::None &&
+                                    Output == "-")
+                                    return Opts.invalid("compressed output "
+                                                        "needs 'output'");
+                                unsigned Shard = Opts.getUnsigned("shard", 0);
+                                if (Shard && Output == "-")
+                                    return Opts.invalid("sharded output "
+                                                        "needs 'output'");
+                                // Chunk size in KiB
+                                unsigned Chunk = Opts.getUnsigned("chunk",
+                                                                  1024);
+                                StringRef Mode = Opts.getString("profile",
+                                                                "none");
+                                ProfileMode Profile =
+                                        StringSwitch<ProfileMode>(Mode)
+                                                .Case("hot",
+                                                      ProfileMode::HotOnly)
+                                                .Case("approx",
+                                                      ProfileMode::Approximate)
+                                                .Default(ProfileMode::None);
+                                if (Profile == ProfileMode::None &&
+                                    Mode != "none")
+                                    return Opts.invalid(
+                                            "invalid value for pass parameter "
+                                            "'profile': " + Mode);
+                                MPM.addPass(LivenessDump(
+                                        Opts.getUnsigned("threads", 0),
+                                        Output.str(), Shard, Compress,
+                                        std::max(Chunk, 1u) * size_t(1024),
+                                        Profile,
+                                        Opts.getUnsigned("trace-granularity",
+                                                         500)));
+                                return Opts.valid();
+                            }
+                            if (Opts.parse(Name, "liveness-stats",
+                                           {"rate", "strata", "seed"})) {
+                                double Rate = Opts.getDouble("rate", 0.1);
+                                if (Rate <= 0.0 || Rate > 1.0)
+                                    return Opts.invalid("rate must be in "
+                                                        "(0, 1]");
+                                MPM.addPass(liveness::LivenessStatsPass(
+                                        Rate, Opts.getUnsigned("strata", 4),
+                                        Opts.getUnsigned("seed", 1)));
+                                return Opts.valid();
+                            }
+                            if (Name == "pressure-hints") {
+                                MPM.addPass(liveness::PressureHintsPass());
+                                return true;
+                            }
+                            if (Opts.parse(Name, "pressure-hints-bench",
+                                           {"repeat"})) {
+                                MPM.addPass(liveness::PressureHintsBenchPass(
+                                        Opts.getUnsigned("repeat", 1)));
+                                return Opts.valid();
+                            }
+                            if (Opts.parse(Name, "promote-bench", {"repeat"})) {
+                                MPM.addPass(liveness::PromoteBenchPass(
+                                        Opts.getUnsigned("repeat", 1)));
+                                return Opts.valid();
+                            }
+                            if (Opts.parse(Name, "riv-fuzz",
+                                           {"seed", "runs", "blocks", "values",
+                                            "irreducible", "invokes",
+                                            "unreachable", "threads"})) {
+                                liveness::FuzzOptions Fuzz;
+                                Fuzz.Blocks = Opts.getUnsigned("blocks", 16);
+                                Fuzz.Values = Opts.getUnsigned("values", 4);
+                                Fuzz.Irreducible = Opts.hasFlag("irreducible");
+                                Fuzz.Invokes = Opts.hasFlag("invokes");
+                                Fuzz.Unreachable = Opts.hasFlag("unreachable");
+                                Fuzz.Threads = Opts.getUnsigned("threads", 1);
+                                MPM.addPass(liveness::RIVFuzzPass(
+                                        Opts.getUnsigned("seed", 1),
+                                        Opts.getUnsigned("runs", 100), Fuzz));
+                                return Opts.valid();
+                            }
+                            if (Opts.parse(Name, "spill-cost", {"budget"})) {
+                                MPM.addPass(liveness::SpillCostPass(
+                                        Opts.getUnsigned("budget", 16)));
+                                return Opts.valid();
+                            }
                             return false;
                         });
             }};
@@ -0,0 +1,567 @@
+//=============================================================================
+// DESCRIPTION:
+//    Shared interface of the Liveness plugin. LiveSets holds the classic
+//    backward-dataflow liveness of the SSA values of one function:
+//
+//      LiveOut_N = U_{S in succ(N)} (LiveIn_S  U  PhiUses_{S <- N})
+//      LiveIn_N  = UpwardExposed_N  U  (LiveOut_N - Defs_N)
+//
+//    Phi operands are live at the end of the corresponding predecessor (and
+//    not live-in to the phi's block), phi results are defined at block
+//    entry. Global variables and constants are never tracked.
+//
+//    Values are numbered densely (arguments first, then instructions in
+//    layout order when the sets are computed) and every set is a BitVector
+//    indexed by that ordinal.
+//=============================================================================
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Support/Error.h"
+
+#include <vector>
+
+namespace llvm {
+class AllocaInst;
+class DominatorTree;
+class MemoryBuffer;
+class RegionInfo;
+class ThreadPool;
+} // namespace llvm
+
+namespace liveness {
+
+//-----------------------------------------------------------------------------
+// Reachable values (RIV)
+//-----------------------------------------------------------------------------
+// The first-class values available in every block reachable from the entry:
+// globals, arguments and the values defined in strictly dominating blocks.
+using RIVResult = llvm::MapVector<const llvm::BasicBlock *,
+                                  llvm::SmallPtrSet<llvm::Value *, 8>>;
+
+// The dominator tree walk used by the 'liveness' pass
+RIVResult buildRIV(llvm::Function &F, llvm::DominatorTree &DT);
+// A direct (and slow) transcription of the definition, used as the
+// reference when testing faster variants
+RIVResult buildRIVReference(llvm::Function &F, llvm::DominatorTree &DT);
+// Returns true if A and B have the same blocks and the same set per block
+bool isSameRIV(const RIVResult &A, const RIVResult &B);
+// Prints Result in the format of the 'liveness' pass
+void printRIV(llvm::raw_ostream &OS, const RIVResult &Result);
+
+// Writes the RIV of every function defined in the IR file Path to OS, in the
+// format of 'liveness-dump'. Bitcode is loaded lazily and only one function
+// body is in memory at a time (see LivenessStream.cpp).
+struct StreamStats {
+    unsigned Functions = 0;
+    // Instructions in the largest function
+    size_t MaxInstructions = 0;
+};
+llvm::Expected<StreamStats> streamRIV(llvm::StringRef Path,
+                                      llvm::raw_ostream &OS);
+llvm::Expected<StreamStats>
+streamRIV(std::unique_ptr<llvm::MemoryBuffer> Buffer, llvm::raw_ostream &OS);
+
+// Runs streamRIV on many modules in parallel (see LivenessBatch.cpp). With
+// Numa, workers are pinned to the NUMA nodes and every module is read,
+// analysed and written by a single worker, so its memory stays on one node.
+struct BatchOptions {
+    // 0 for one worker per CPU
+    unsigned Threads = 0;
+    bool Numa = true;
+    // The result for X goes to OutputDir/<file name of X>.riv, or to X.riv
+    // if OutputDir is empty; nowhere if Discard is set
+    std::string OutputDir;
+    bool Discard = false;
+};
+struct BatchStats {
+    unsigned Modules = 0;
+    unsigned Failed = 0;
+    unsigned Nodes = 0;
+    unsigned Threads = 0;
+    double Seconds = 0;
+};
+BatchStats runBatch(llvm::ArrayRef<std::string> Inputs,
+                    const BatchOptions &Opts);
+// Times runBatch with and without Numa for 1, 2, 4, ... MaxThreads workers
+// (0 for one per CPU)
+void benchBatch(llvm::ArrayRef<std::string> Inputs, unsigned MaxThreads,
+                llvm::raw_ostream &OS);
+
+//-----------------------------------------------------------------------------
+// LiveSets
+//-----------------------------------------------------------------------------
+class LiveSets {
+public:
+    // Solves the whole function at once (the default engine)
+    explicit LiveSets(llvm::Function &F);
+    // Solves every SESE region of RI independently (the regions of a tree
+    // level in parallel on Pool, if there is one) and composes the region
+    // summaries. The result is identical to the flat engine's.
+    LiveSets(llvm::Function &F, llvm::RegionInfo &RI,
+             llvm::ThreadPool *Pool = nullptr);
+
+    llvm::Function &getFunction() const { return *F; }
+
+    // Value numbering
+    unsigned getNumValues() const { return Values.size(); }
+    llvm::Value *getValue(unsigned Idx) const { return Values[Idx]; }
+    // Returns the ordinal of V, or -1 if V is not tracked.
+    int getIndex(const llvm::Value *V) const;
+    bool isTracked(const llvm::Value *V) const { return getIndex(V) >= 0; }
+
+    // Block-level sets
+    const llvm::BitVector &getLiveIn(const llvm::BasicBlock *BB) const;
+    const llvm::BitVector &getLiveOut(const llvm::BasicBlock *BB) const;
+    bool isLiveIn(const llvm::Value *V, const llvm::BasicBlock *BB) const;
+    bool isLiveOut(const llvm::Value *V, const llvm::BasicBlock *BB) const;
+    // Values live on the edge From -> To, i.e. live-in of To plus the phi
+    // operands of To incoming from From.
+    llvm::BitVector getLiveOnEdge(const llvm::BasicBlock *From,
+                                  const llvm::BasicBlock *To) const;
+
+    // Instruction-level sets are derived on demand from the block live-outs.
+    // Fn(I, LiveAfter) is called for every instruction of BB, last to first,
+    // with the set of values live immediately after I.
+    void walkBlockBackward(
+            const llvm::BasicBlock &BB,
+            llvm::function_ref<void(const llvm::Instruction &,
+                                    const llvm::BitVector &)> Fn) const;
+    llvm::BitVector getLiveAfter(const llvm::Instruction *I) const;
+    llvm::BitVector getLiveBefore(const llvm::Instruction *I) const;
+
+    // Register pressure only counts values that need a register, i.e. not
+    // static allocas (frame indices) or tokens.
+    const llvm::BitVector &getRegisterMask() const { return RegMask; }
+    unsigned getPressure(const llvm::BitVector &Live) const;
+    unsigned getMaxPressure(const llvm::BasicBlock *BB) const;
+
+    void print(llvm::raw_ostream &OS) const;
+    void printSet(llvm::raw_ostream &OS, const llvm::BitVector &Set) const;
+
+    // Returns true if both results hold the same block-level sets
+    bool isSameAs(const LiveSets &Other) const;
+    // The same, comparing values rather than ordinals (e.g. after
+    // instructions were moved)
+    bool isEquivalentTo(const LiveSets &Other) const;
+
+    // Incremental update: recomputes the sets of V alone, after its
+    // definition or some of its uses moved to other blocks. Phis must not
+    // move, the value numbering is kept.
+    void updateValue(const llvm::Value *V);
+
+    // Serialisation (see LivenessMetadata.cpp). attachMetadata stores the
+    // live-in set of every block in the function's metadata, loadMetadata
+    // rebuilds the result from it without solving the dataflow. It returns
+    // None if there is no metadata or the function changed since.
+    void attachMetadata() const;
+    static llvm::Optional<LiveSets> loadMetadata(llvm::Function &F);
+
+private:
+    LiveSets() = default;
+
+    struct BlockSets {
+        llvm::BitVector LiveIn;
+        llvm::BitVector LiveOut;
+    };
+    struct LocalSets {
+        llvm::BitVector Defs;
+        llvm::BitVector UpExposed;
+    };
+    using LocalMapTy = llvm::DenseMap<const llvm::BasicBlock *, LocalSets>;
+
+    void numberValues();
+    LocalMapTy computeLocalSets();
+    void solveFlat(llvm::ArrayRef<const llvm::BasicBlock *> Order,
+                   const LocalMapTy &Local);
+    void solveRegions(llvm::RegionInfo &RI, llvm::ThreadPool *Pool,
+                      const LocalMapTy &Local);
+
+    llvm::Function *F = nullptr;
+    std::vector<llvm::Value *> Values;
+    llvm::DenseMap<const llvm::Value *, unsigned> Index;
+    llvm::DenseMap<const llvm::BasicBlock *, BlockSets> Blocks;
+    // Phi operands keyed by the (incoming block, phi block) edge
+    llvm::DenseMap<std::pair<const llvm::BasicBlock *,
+                             const llvm::BasicBlock *>,
+                   llvm::BitVector> PhiUses;
+    llvm::BitVector RegMask;
+};
+
+// The blocks a variable is live-in to: every block on a path from a use
+// back to a definition. UseBlocks read the variable before defining it (if
+// at all), DefBlocks define it. Also used for variables in memory.
+void computeLiveInBlocks(
+        llvm::ArrayRef<const llvm::BasicBlock *> UseBlocks,
+        const llvm::SmallPtrSetImpl<const llvm::BasicBlock *> &DefBlocks,
+        llvm::SmallPtrSetImpl<const llvm::BasicBlock *> &LiveIn);
+
+// Returns true if V occupies a register while it is live.
+bool needsRegister(const llvm::Value *V);
+
+// Returns true if I is cheap to recompute and free of side effects:
+// address computations, casts, compares and non-trapping arithmetic.
+bool isCheapToRecompute(const llvm::Instruction *I);
+
+// Returns true if Def could be recomputed right before Use, i.e. it is cheap
+// and each of its operands is a constant, a static alloca or a value that is
+// already live at Use.
+bool canRematerializeAt(const LiveSets &LS, const llvm::Instruction *Def,
+                        const llvm::Use &Use);
+
+//-----------------------------------------------------------------------------
+// InterferenceQuery
+//-----------------------------------------------------------------------------
+// Answers "do A and B interfere?" in constant time. In strict SSA two values
+// interfere iff the one whose definition dominates the other's is live right
+// after that other definition. Dominance between definitions comes from the
+// dominator tree DFS numbers and the position inside the block, liveness
+// from the live-out sets plus the last use of every value in every block.
+class InterferenceQuery {
+public:
+    InterferenceQuery(const LiveSets &LS, llvm::DominatorTree &DT);
+
+    bool interfere(const llvm::Value *A, const llvm::Value *B) const;
+    // Batch mode: returns the first member of Class that V interferes with,
+    // or nullptr. Class is typically a congruence class being coalesced.
+    const llvm::Value *
+    findInterference(const llvm::Value *V,
+                     llvm::ArrayRef<const llvm::Value *> Class) const;
+
+private:
+    struct DefPoint {
+        const llvm::BasicBlock *BB = nullptr;
+        bool Reachable = false;
+        unsigned DFSIn = 0, DFSOut = 0;
+        // 0 for arguments and phis, 1 + index for the other instructions
+        unsigned Pos = 0;
+    };
+
+    bool dominates(const DefPoint &A, const DefPoint &B) const;
+    bool isLiveAt(int IdxA, const DefPoint &B) const;
+    bool interfere(int IdxA, int IdxB) const;
+
+    const LiveSets &LS;
+    std::vector<DefPoint> Defs;
+    // Position of the last non-phi use of a value in a block
+    llvm::DenseMap<std::pair<unsigned, const llvm::BasicBlock *>, unsigned>
+            LastUse;
+};
+
+//-----------------------------------------------------------------------------
+// Analysis and printer passes
+//-----------------------------------------------------------------------------
+struct LiveSetsAnalysis : llvm::AnalysisInfoMixin<LiveSetsAnalysis> {
+    using Result = LiveSets;
+    Result run(llvm::Function &F, llvm::FunctionAnalysisManager &FAM);
+
+private:
+    friend llvm::AnalysisInfoMixin<LiveSetsAnalysis>;
+    static llvm::AnalysisKey Key;
+};
+
+// Attaches the live-in sets to every function as metadata, reusing the
+// sets already attached when the function is unchanged
+struct AttachLivenessPass : llvm::PassInfoMixin<AttachLivenessPass> {
+    explicit AttachLivenessPass(bool Verify) : Verify(Verify) {}
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+
+private:
+    // Check reused sets against a fresh computation
+    bool Verify;
+};
+
+// Checks the region engine against the flat one and times both
+struct LiveSetsBenchPass : llvm::PassInfoMixin<LiveSetsBenchPass> {
+    LiveSetsBenchPass(unsigned Threads, unsigned Repeat)
+            : Threads(Threads), Repeat(Repeat) {}
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+
+private:
+    unsigned Threads;
+    unsigned Repeat;
+};
+
+struct LiveSetsPrinter : llvm::PassInfoMixin<LiveSetsPrinter> {
+    explicit LiveSetsPrinter(llvm::raw_ostream &OS) : OS(OS) {}
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+
+private:
+    llvm::raw_ostream &OS;
+};
+
+// Prints, for every value, the values numbered before it that it interferes
+// with and the answer of findInterference for the same set
+struct InterferencePrinter : llvm::PassInfoMixin<InterferencePrinter> {
+    explicit InterferencePrinter(llvm::raw_ostream &OS) : OS(OS) {}
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+
+private:
+    llvm::raw_ostream &OS;
+};
+
+// Prints the IR with the live sets as comments (see AnnotatedIR.cpp)
+struct LiveIRPrinter : llvm::PassInfoMixin<LiveIRPrinter> {
+    LiveIRPrinter(llvm::raw_ostream &OS, bool Insts, bool Delta)
+            : OS(OS), Insts(Insts), Delta(Delta) {}
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+
+private:
+    llvm::raw_ostream &OS;
+    bool Insts;
+    bool Delta;
+};
+
+//-----------------------------------------------------------------------------
+// Pipeline parameters
+//-----------------------------------------------------------------------------
+// Plugin options are passed in the pipeline text, e.g.
+// '-passes=riv-fuzz<runs=50;irreducible>'. A key without '=' is a flag.
+// Invalid parameters are reported to errs() and make valid() false; the
+// parsing callback then returns false and opt rejects the pipeline.
+class PassOptions {
+public:
+    // Returns true if Name is PassName, optionally followed by '<...>'.
+    // Parameters other than Keys are reported as invalid.
+    bool parse(llvm::StringRef Name, llvm::StringRef PassName,
+               llvm::ArrayRef<llvm::StringRef> Keys);
+
+    bool hasFlag(llvm::StringRef Key) const { return Opts.count(Key); }
+    llvm::StringRef getString(llvm::StringRef Key,
+                              llvm::StringRef Default = "") const;
+    // Malformed numbers are reported and replaced by Default
+    unsigned getUnsigned(llvm::StringRef Key, unsigned Default);
+    double getDouble(llvm::StringRef Key, double Default);
+
+    // Reports Msg for the current pass. Returns false, for use as the
+    // result of the parsing callback.
+    bool invalid(const llvm::Twine &Msg);
+    bool valid() const { return !Invalid; }
+
+private:
+    llvm::StringMap<std::string> Opts;
+    std::string PassName;
+    bool Invalid = false;
+};
+
+//-----------------------------------------------------------------------------
+// Passes built on top of LiveSets
+//-----------------------------------------------------------------------------
+// Frequency-weighted spill cost estimate, ranked across the module
+struct SpillCostPass : llvm::PassInfoMixin<SpillCostPass> {
+    explicit SpillCostPass(unsigned Budget) : Budget(Budget) {}
+    llvm::PreservedAnalyses run(llvm::Module &M,
+                                llvm::ModuleAnalysisManager &MAM);
+
+private:
+    unsigned Budget;
+};
+
+// Live-through values of high-pressure blocks that could be recomputed at
+// their uses instead of occupying a register
+struct RematCandidatesPass : llvm::PassInfoMixin<RematCandidatesPass> {
+    explicit RematCandidatesPass(unsigned Budget) : Budget(Budget) {}
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+
+private:
+    unsigned Budget;
+};
+
+// Values and allocas live across each llvm.coro.suspend, and the frame
+// bytes they need compared with what CoroSplit would allocate
+struct CoroLivenessPass : llvm::PassInfoMixin<CoroLivenessPass> {
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+};
+
+// Copies SSA destruction will need, estimated per phi web from pairwise
+// dominance/liveness interference checks
+struct PhiCopiesPass : llvm::PassInfoMixin<PhiCopiesPass> {
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+};
+
+// Stored memory live at each block, per underlying object, and stores no
+// path ever reads (one object per task)
+struct MemoryLivenessPass : llvm::PassInfoMixin<MemoryLivenessPass> {
+    explicit MemoryLivenessPass(unsigned Threads) : Threads(Threads) {}
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+
+private:
+    unsigned Threads;
+};
+
+// Lanes of each vector value that are ever read, and the vector register
+// pressure saved by narrowing values to their live lanes
+struct VectorLanesPass : llvm::PassInfoMixin<VectorLanesPass> {
+    explicit VectorLanesPass(unsigned Width) : Width(Width) {}
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+
+private:
+    unsigned Width;
+};
+
+// Per-field live ranges of aggregate allocas and the stack bytes splitting
+// them into their fields would save
+struct FieldLivenessPass : llvm::PassInfoMixin<FieldLivenessPass> {
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+};
+
+// Values live across every call site, by register class, with a
+// frequency-weighted per-function summary
+struct CallCrossingPass : llvm::PassInfoMixin<CallCrossingPass> {
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+};
+
+// Module-wide pressure and live-set statistics extrapolated, with 95%
+// confidence intervals, from a size-stratified sample of the functions
+struct LivenessStatsPass : llvm::PassInfoMixin<LivenessStatsPass> {
+    LivenessStatsPass(double Rate, unsigned Strata, uint64_t Seed)
+            : Rate(Rate), Strata(Strata), Seed(Seed) {}
+    llvm::PreservedAnalyses run(llvm::Module &M,
+                                llvm::ModuleAnalysisManager &MAM);
+
+private:
+    double Rate;
+    unsigned Strata;
+    uint64_t Seed;
+};
+
+// Shape of the functions generated by 'riv-fuzz'
+struct FuzzOptions {
+    unsigned Blocks = 16;
+    // Upper bound of the arithmetic instructions per block
+    unsigned Values = 4;
+    bool Irreducible = false;
+    bool Invokes = false;
+    // Adds blocks that are not reachable from the entry
+    bool Unreachable = false;
+    // Threads of the region engine (0: one per core)
+    unsigned Threads = 1;
+};
+
+// Generates one random function from Seed and checks buildRIV and the
+// region engine against their references. Returns false on a mismatch.
+bool runRIVFuzz(uint64_t Seed, const FuzzOptions &Opts);
+
+// Differential checker and benchmark over Runs random functions generated
+// from consecutive seeds (the input module is not used)
+struct RIVFuzzPass : llvm::PassInfoMixin<RIVFuzzPass> {
+    RIVFuzzPass(uint64_t Seed, unsigned Runs, FuzzOptions Opts)
+            : Seed(Seed), Runs(Runs), Opts(Opts) {}
+    llvm::PreservedAnalyses run(llvm::Module &M,
+                                llvm::ModuleAnalysisManager &MAM);
+
+private:
+    uint64_t Seed;
+    unsigned Runs;
+    FuzzOptions Opts;
+};
+
+//-----------------------------------------------------------------------------
+// Pressure hints
+//-----------------------------------------------------------------------------
+// A summary of a function's register pressure, attached to the function as
+// string attributes so that a later optimiser (e.g. a JIT tier, see
+// LivenessJIT.h) can read it without recomputing liveness
+struct PressureHints {
+    unsigned MaxPressure = 0;
+    // Average over all program points (after every instruction)
+    double AvgPressure = 0.0;
+};
+
+PressureHints computePressureHints(const LiveSets &LS);
+void setPressureHints(llvm::Function &F, const PressureHints &Hints);
+// The hints attached to F, if any
+llvm::Optional<PressureHints> getPressureHints(const llvm::Function &F);
+// Attaches hints to every defined function of M that has none yet. Returns
+// the number of functions analysed.
+unsigned annotatePressureHints(llvm::Module &M);
+
+// Runs annotatePressureHints, i.e. what the JIT layer does per module
+struct PressureHintsPass : llvm::PassInfoMixin<PressureHintsPass> {
+    llvm::PreservedAnalyses run(llvm::Module &M,
+                                llvm::ModuleAnalysisManager &MAM);
+};
+
+// Reorders the instructions of each block, within their dependences, to
+// lower its peak register pressure. Block live sets are unchanged, so the
+// cached LiveSets are preserved.
+struct PressureSchedPass : llvm::PassInfoMixin<PressureSchedPass> {
+    explicit PressureSchedPass(bool Verify) : Verify(Verify) {}
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+
+private:
+    // Check the preserved sets against a fresh computation
+    bool Verify;
+};
+
+// Sinks definitions to the common dominator of their uses when that
+// shortens live ranges, updating the cached LiveSets incrementally
+struct DefinitionSinkingPass : llvm::PassInfoMixin<DefinitionSinkingPass> {
+    explicit DefinitionSinkingPass(bool Verify) : Verify(Verify) {}
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+
+private:
+    // Check the updated sets against a fresh computation
+    bool Verify;
+};
+
+// Promotes Allocas (all in one function, see PromoteAllocas.cpp for the
+// supported uses) to SSA values with phis only where they are live.
+// Returns the number of phis inserted.
+unsigned promoteAllocas(llvm::ArrayRef<llvm::AllocaInst *> Allocas,
+                        llvm::DominatorTree &DT);
+
+struct PromoteAllocasPass : llvm::PassInfoMixin<PromoteAllocasPass> {
+    llvm::PreservedAnalyses run(llvm::Function &F,
+                                llvm::FunctionAnalysisManager &FAM);
+};
+
+// Compares promoteAllocas with PromoteMemToReg in time and phi count
+struct PromoteBenchPass : llvm::PassInfoMixin<PromoteBenchPass> {
+    explicit PromoteBenchPass(unsigned Repeat) : Repeat(Repeat) {}
+    llvm::PreservedAnalyses run(llvm::Module &M,
+                                llvm::ModuleAnalysisManager &MAM);
+
+private:
+    unsigned Repeat;
+};
+
+// Times the liveness computation and the hints per function, compared with
+// deriving the hints from a pressure count at every program point
+struct PressureHintsBenchPass : llvm::PassInfoMixin<PressureHintsBenchPass> {
+    explicit PressureHintsBenchPass(unsigned Repeat) : Repeat(Repeat) {}
+    llvm::PreservedAnalyses run(llvm::Module &M,
+                                llvm::ModuleAnalysisManager &MAM);
+
+private:
+    unsigned Repeat;
+};
+
+} // namespace liveness
+
+#endif // LIVENESS_H
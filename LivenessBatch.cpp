@@ -0,0 +1,300 @@
+//=============================================================================
+// DESCRIPTION:
+//    Runs the streaming RIV dump (see LivenessStream.cpp) on many modules in
+//    parallel. On a multi-socket host a module parsed on one NUMA node and
+//    analysed on another pays for remote memory on every access, so with
+//    BatchOptions::Numa:
+//      * every NUMA node gets its own workers, pinned to the node's CPUs,
+//        and its own queue of modules
+//      * a module is read, analysed and written by one worker, so its memory
+//        lives on that worker's node: the bitcode is read into the heap
+//        rather than mapped, and the allocator's per-thread arenas place
+//        the IR on the node that first touches it
+//    A worker whose queue runs dry takes modules from the back of the other
+//    queues. The topology comes from /sys/devices/system/node (Linux); without
+//    it all CPUs form one node.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Read the CPUs of every node, restricted to the CPUs the process may use
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    Distribute the modules over the node queues, largest first, each to the
+//    node with the fewest bytes per worker queued so far
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Start the workers round-robin over the nodes; each pins itself and
+//    drains its node's queue, then steals from the others
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+using CPUList = std::vector<unsigned>;
+
+// CPUs this process may run on
+CPUList getAllowedCPUs() {
+    CPUList CPUs;
+#ifdef __linux__
+    cpu_set_t Set;
+    if (sched_getaffinity(0, sizeof(Set), &Set) == 0) {
+        for (unsigned CPU = 0; CPU != CPU_SETSIZE; ++CPU)
+            if (CPU_ISSET(CPU, &Set))
+                CPUs.push_back(CPU);
+        return CPUs;
+    }
+#endif
+    for (unsigned CPU = 0, E = hardware_concurrency().compute_thread_count();
+         CPU != E; ++CPU)
+        CPUs.push_back(CPU);
+    return CPUs;
+}
+
+// Parses a sysfs CPU list such as "0-3,8-11"
+CPUList parseCPUList(StringRef Text) {
+    CPUList CPUs;
+    SmallVector<StringRef, 8> Ranges;
+    Text.trim().split(Ranges, ',', -1, false);
+    for (StringRef Range : Ranges) {
+        StringRef First, Last;
+        std::tie(First, Last) = Range.split('-');
+        unsigned Begin, End;
+        if (First.getAsInteger(10, Begin))
+            continue;
+        if (Last.empty())
+            End = Begin;
+        else if (Last.getAsInteger(10, End))
+            continue;
+        for (unsigned CPU = Begin; CPU <= End; ++CPU)
+            CPUs.push_back(CPU);
+    }
+    return CPUs;
+}
+
+// STEP 1: The CPUs of every node
+std::vector<CPUList> getNodes(const CPUList &Allowed) {
+    std::vector<CPUList> Nodes;
+    std::error_code EC;
+    const char *Root = "/sys/devices/system/node";
+    for (sys::fs::directory_iterator It(Root, EC), E; It != E && !EC;
+         It.increment(EC)) {
+        StringRef Name = sys::path::filename(It->path());
+        unsigned Node;
+        if (!Name.consume_front("node") || Name.getAsInteger(10, Node))
+            continue;
+        // sysfs reports a size that is not the content's, read to EOF
+        ErrorOr<std::unique_ptr<MemoryBuffer>> List =
+                MemoryBuffer::getFileAsStream(It->path() + "/cpulist");
+        if (!List)
+            continue;
+        CPUList CPUs;
+        for (unsigned CPU : parseCPUList((*List)->getBuffer()))
+            if (is_contained(Allowed, CPU))
+                CPUs.push_back(CPU);
+        if (!CPUs.empty()) {
+            Nodes.resize(std::max<size_t>(Nodes.size(), Node + 1));
+            Nodes[Node] = std::move(CPUs);
+        }
+    }
+    // Node numbers may have holes
+    erase_if(Nodes, [](const CPUList &CPUs) { return CPUs.empty(); });
+    if (Nodes.empty())
+        Nodes.push_back(Allowed);
+    return Nodes;
+}
+
+void pinToCPUs(const CPUList &CPUs) {
+#ifdef __linux__
+    cpu_set_t Set;
+    CPU_ZERO(&Set);
+    for (unsigned CPU : CPUs)
+        CPU_SET(CPU, &Set);
+    sched_setaffinity(0, sizeof(Set), &Set);
+#endif
+}
+
+struct NodeQueue {
+    std::mutex Lock;
+    std::deque<size_t> Modules;
+    uint64_t Bytes = 0;
+    unsigned Workers = 0;
+};
+
+std::string getOutputPath(const std::string &Input,
+                          const std::string &OutputDir) {
+    if (OutputDir.empty())
+        return Input + ".riv";
+    SmallString<128> Path(OutputDir);
+    sys::path::append(Path, sys::path::filename(Input) + ".riv");
+    return std::string(Path.str());
+}
+} // namespace
+
+BatchStats runBatch(ArrayRef<std::string> Inputs, const BatchOptions &Opts) {
+    TimeRecord Start = TimeRecord::getCurrentTime(true);
+
+    // STEP 1: Topology
+    CPUList Allowed = getAllowedCPUs();
+    std::vector<CPUList> Nodes;
+    if (Opts.Numa)
+        Nodes = getNodes(Allowed);
+    else
+        Nodes.push_back(Allowed);
+    unsigned Threads = Opts.Threads ? Opts.Threads : Allowed.size();
+    Threads = std::max(Threads, 1u);
+
+    // Nodes without workers get no modules either
+    Nodes.resize(std::min<size_t>(Nodes.size(), Threads));
+    std::vector<NodeQueue> Queues(Nodes.size());
+    for (unsigned W = 0; W != Threads; ++W)
+        ++Queues[W % Nodes.size()].Workers;
+
+    // STEP 2: Largest modules first, to the least loaded node
+    std::vector<std::pair<uint64_t, size_t>> BySize;
+    for (size_t I = 0, E = Inputs.size(); I != E; ++I) {
+        uint64_t Size = 0;
+        sys::fs::file_size(Inputs[I], Size);
+        BySize.push_back({Size, I});
+    }
+    llvm::sort(BySize, [](const std::pair<uint64_t, size_t> &A,
+                          const std::pair<uint64_t, size_t> &B) {
+        return A.first > B.first || (A.first == B.first && A.second < B.second);
+    });
+    for (auto &Module : BySize) {
+        NodeQueue *Best = &Queues.front();
+        for (NodeQueue &Q : Queues)
+            if (Q.Bytes * Best->Workers < Best->Bytes * Q.Workers)
+                Best = &Q;
+        Best->Modules.push_back(Module.second);
+        Best->Bytes += Module.first;
+    }
+
+    // STEP 3: Workers
+    auto Pop = [&](unsigned Node, size_t &Module) {
+        for (unsigned I = 0, E = Queues.size(); I != E; ++I) {
+            NodeQueue &Q = Queues[(Node + I) % E];
+            std::lock_guard<std::mutex> Guard(Q.Lock);
+            if (Q.Modules.empty())
+                continue;
+            // Own queue from the front, others from the back
+            if (I == 0) {
+                Module = Q.Modules.front();
+                Q.Modules.pop_front();
+            } else {
+                Module = Q.Modules.back();
+                Q.Modules.pop_back();
+            }
+            return true;
+        }
+        return false;
+    };
+
+    std::atomic<unsigned> Failed(0);
+    std::mutex ErrorLock;
+    // Errors name the file they are about
+    auto Report = [&](Error E) {
+        ++Failed;
+        std::lock_guard<std::mutex> Guard(ErrorLock);
+        errs() << "liveness-stream: " << toString(std::move(E)) << "\n";
+    };
+    ThreadPool Pool(hardware_concurrency(Threads));
+    for (unsigned W = 0; W != Threads; ++W)
+        Pool.async([&, W] {
+            unsigned Node = W % Nodes.size();
+            if (Opts.Numa)
+                pinToCPUs(Nodes[Node]);
+            size_t Module;
+            while (Pop(Node, Module)) {
+                const std::string &Input = Inputs[Module];
+                // Read (not mapped), so the pages are first touched here
+                ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+                        MemoryBuffer::getFile(Input, /*IsText=*/false,
+                                              /*RequiresNullTerminator=*/true,
+                                              /*IsVolatile=*/true);
+                if (!Buffer) {
+                    Report(createFileError(Input, Buffer.getError()));
+                    continue;
+                }
+                // A failed module leaves no (partial) output behind
+                std::unique_ptr<ToolOutputFile> Out;
+                raw_null_ostream NullOS;
+                raw_ostream *OS = &NullOS;
+                if (!Opts.Discard) {
+                    std::error_code EC;
+                    std::string Path = getOutputPath(Input, Opts.OutputDir);
+                    Out = std::make_unique<ToolOutputFile>(Path, EC,
+                                                           sys::fs::OF_None);
+                    if (EC) {
+                        Report(createFileError(Path, EC));
+                        continue;
+                    }
+                    OS = &Out->os();
+                }
+                Expected<StreamStats> Stats =
+                        streamRIV(std::move(*Buffer), *OS);
+                if (!Stats) {
+                    Report(createFileError(Input, Stats.takeError()));
+                    continue;
+                }
+                if (Out)
+                    Out->keep();
+            }
+        });
+    Pool.wait();
+
+    BatchStats Stats;
+    Stats.Modules = Inputs.size();
+    Stats.Failed = Failed;
+    Stats.Nodes = Nodes.size();
+    Stats.Threads = Threads;
+    Stats.Seconds = TimeRecord::getCurrentTime(false).getWallTime() -
+                    Start.getWallTime();
+    return Stats;
+}
+
+void benchBatch(ArrayRef<std::string> Inputs, unsigned MaxThreads,
+                raw_ostream &OS) {
+    if (!MaxThreads)
+        MaxThreads = getAllowedCPUs().size();
+    OS << format("batch scaling: %u modules, output discarded\n",
+                 static_cast<unsigned>(Inputs.size()));
+    OS << "threads   shared (s)  modules/s    numa (s)  modules/s  nodes\n";
+    for (unsigned Threads = 1;; Threads = std::min(Threads * 2, MaxThreads)) {
+        BatchOptions Opts;
+        Opts.Threads = Threads;
+        Opts.Discard = true;
+        Opts.Numa = false;
+        BatchStats Shared = runBatch(Inputs, Opts);
+        Opts.Numa = true;
+        BatchStats Numa = runBatch(Inputs, Opts);
+        OS << format("%7u %12.3f %10.1f %11.3f %10.1f %6u\n", Threads,
+                     Shared.Seconds, Shared.Modules / Shared.Seconds,
+                     Numa.Seconds, Numa.Modules / Numa.Seconds, Numa.Nodes);
+        if (Threads == MaxThreads)
+            break;
+    }
+}
+
+} // namespace liveness
@@ -0,0 +1,137 @@
+//=============================================================================
+// DESCRIPTION:
+//    Implementation of the C interface (see LivenessC.h). Handles are plain
+//    casts of LiveSets and of the structures below; the cache is a
+//    FunctionAnalysisManager with only LiveSetsAnalysis registered, so it
+//    caches and invalidates exactly like the passes do.
+//=============================================================================
+#include "LivenessC.h"
+#include "Liveness.h"
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Instruction.h"
+
+using namespace llvm;
+
+namespace {
+struct LivenessCache {
+    LivenessCache() {
+        FAM.registerPass([] { return PassInstrumentationAnalysis(); });
+        FAM.registerPass([] { return liveness::LiveSetsAnalysis(); });
+    }
+    FunctionAnalysisManager FAM;
+};
+
+// Block sets point into the analysis, instruction sets own their bits
+struct LiveSet {
+    static LiveSet *borrow(const BitVector &Bits) {
+        auto *S = new LiveSet();
+        S->Bits = &Bits;
+        return S;
+    }
+    static LiveSet *own(BitVector Bits) {
+        auto *S = new LiveSet();
+        S->Owned = std::move(Bits);
+        S->Bits = &S->Owned;
+        return S;
+    }
+    BitVector Owned;
+    const BitVector *Bits = nullptr;
+};
+
+liveness::LiveSets *unwrap(LivenessRef L) {
+    return reinterpret_cast<liveness::LiveSets *>(L);
+}
+LivenessRef wrap(const liveness::LiveSets *LS) {
+    return reinterpret_cast<LivenessRef>(
+            const_cast<liveness::LiveSets *>(LS));
+}
+LivenessCache *unwrap(LivenessCacheRef C) {
+    return reinterpret_cast<LivenessCache *>(C);
+}
+LiveSet *unwrap(LiveSetRef S) { return reinterpret_cast<LiveSet *>(S); }
+LiveSetRef wrap(LiveSet *S) { return reinterpret_cast<LiveSetRef>(S); }
+} // namespace
+
+LivenessRef LivenessCreate(LLVMValueRef Fn) {
+    return wrap(new liveness::LiveSets(*unwrap<Function>(Fn)));
+}
+
+void LivenessDispose(LivenessRef L) { delete unwrap(L); }
+
+LivenessCacheRef LivenessCacheCreate(void) {
+    return reinterpret_cast<LivenessCacheRef>(new LivenessCache());
+}
+
+void LivenessCacheDispose(LivenessCacheRef C) { delete unwrap(C); }
+
+LivenessRef LivenessCacheGet(LivenessCacheRef C, LLVMValueRef Fn) {
+    return wrap(&unwrap(C)->FAM.getResult<liveness::LiveSetsAnalysis>(
+            *unwrap<Function>(Fn)));
+}
+
+void LivenessCacheInvalidate(LivenessCacheRef C, LLVMValueRef Fn) {
+    Function &F = *unwrap<Function>(Fn);
+    unwrap(C)->FAM.clear(F, F.getName());
+}
+
+unsigned LivenessGetNumValues(LivenessRef L) {
+    return unwrap(L)->getNumValues();
+}
+
+LLVMValueRef LivenessGetValue(LivenessRef L, unsigned Index) {
+    return wrap(unwrap(L)->getValue(Index));
+}
+
+int LivenessGetIndex(LivenessRef L, LLVMValueRef V) {
+    return unwrap(L)->getIndex(unwrap(V));
+}
+
+LLVMBool LivenessIsLiveIn(LivenessRef L, LLVMValueRef V,
+                          LLVMBasicBlockRef BB) {
+    return unwrap(L)->isLiveIn(unwrap(V), unwrap(BB));
+}
+
+LLVMBool LivenessIsLiveOut(LivenessRef L, LLVMValueRef V,
+                           LLVMBasicBlockRef BB) {
+    return unwrap(L)->isLiveOut(unwrap(V), unwrap(BB));
+}
+
+LLVMBool LivenessIsLiveAfter(LivenessRef L, LLVMValueRef V,
+                             LLVMValueRef Inst) {
+    int Idx = unwrap(L)->getIndex(unwrap(V));
+    return Idx >= 0 &&
+           unwrap(L)->getLiveAfter(unwrap<Instruction>(Inst)).test(Idx);
+}
+
+LiveSetRef LivenessGetLiveIn(LivenessRef L, LLVMBasicBlockRef BB) {
+    return wrap(LiveSet::borrow(unwrap(L)->getLiveIn(unwrap(BB))));
+}
+
+LiveSetRef LivenessGetLiveOut(LivenessRef L, LLVMBasicBlockRef BB) {
+    return wrap(LiveSet::borrow(unwrap(L)->getLiveOut(unwrap(BB))));
+}
+
+LiveSetRef LivenessGetLiveBefore(LivenessRef L, LLVMValueRef Inst) {
+    return wrap(
+            LiveSet::own(unwrap(L)->getLiveBefore(unwrap<Instruction>(Inst))));
+}
+
+LiveSetRef LivenessGetLiveAfter(LivenessRef L, LLVMValueRef Inst) {
+    return wrap(
+            LiveSet::own(unwrap(L)->getLiveAfter(unwrap<Instruction>(Inst))));
+}
+
+void LiveSetDispose(LiveSetRef S) { delete unwrap(S); }
+
+unsigned LiveSetSize(LiveSetRef S) { return unwrap(S)->Bits->count(); }
+
+LLVMBool LiveSetContains(LiveSetRef S, unsigned Index) {
+    const BitVector &Bits = *unwrap(S)->Bits;
+    return Index < Bits.size() && Bits.test(Index);
+}
+
+int LiveSetNext(LiveSetRef S, int Prev) {
+    const BitVector &Bits = *unwrap(S)->Bits;
+    return Prev < 0 ? Bits.find_first() : Bits.find_next(Prev);
+}
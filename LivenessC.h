@@ -0,0 +1,74 @@
+/*===----------------------------------------------------------------------===*\
+ * DESCRIPTION:
+ *    C interface of the Liveness plugin, for clients that embed LLVM (e.g. a
+ *    JIT) and query liveness in-process. Everything is answered from the
+ *    LiveSets of a function, either owned by the caller (LivenessCreate) or
+ *    kept in a cache of analyses (LivenessCacheGet) that is recomputed only
+ *    after LivenessCacheInvalidate.
+ *
+ *    Values are identified by their ordinal in the LiveSets (arguments first,
+ *    then instructions in layout order); sets are iterated by ordinal:
+ *
+ *      LiveSetRef Set = LivenessGetLiveIn(L, BB);
+ *      for (int I = LiveSetNext(Set, -1); I >= 0; I = LiveSetNext(Set, I))
+ *          use(LivenessGetValue(L, I));
+ *      LiveSetDispose(Set);
+\*===----------------------------------------------------------------------===*/
+#ifndef LIVENESS_C_H
+#define LIVENESS_C_H
+
+#include "llvm-c/Types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct LivenessOpaque *LivenessRef;
+typedef struct LivenessCacheOpaque *LivenessCacheRef;
+typedef struct LiveSetOpaque *LiveSetRef;
+
+/* Analyses Fn. The result is owned by the caller. */
+LivenessRef LivenessCreate(LLVMValueRef Fn);
+void LivenessDispose(LivenessRef L);
+
+/* A cache of analyses. LivenessCacheGet returns the cached analysis of Fn,
+ * computing it on the first request; it is owned by the cache and stays
+ * valid until Fn is invalidated or the cache is disposed. Invalidate a
+ * function whenever its IR changes. */
+LivenessCacheRef LivenessCacheCreate(void);
+void LivenessCacheDispose(LivenessCacheRef C);
+LivenessRef LivenessCacheGet(LivenessCacheRef C, LLVMValueRef Fn);
+void LivenessCacheInvalidate(LivenessCacheRef C, LLVMValueRef Fn);
+
+/* Value numbering. LivenessGetIndex returns -1 for untracked values
+ * (constants, globals, void instructions). */
+unsigned LivenessGetNumValues(LivenessRef L);
+LLVMValueRef LivenessGetValue(LivenessRef L, unsigned Index);
+int LivenessGetIndex(LivenessRef L, LLVMValueRef V);
+
+/* Point queries */
+LLVMBool LivenessIsLiveIn(LivenessRef L, LLVMValueRef V, LLVMBasicBlockRef BB);
+LLVMBool LivenessIsLiveOut(LivenessRef L, LLVMValueRef V,
+                           LLVMBasicBlockRef BB);
+LLVMBool LivenessIsLiveAfter(LivenessRef L, LLVMValueRef V,
+                             LLVMValueRef Inst);
+
+/* Sets. Block sets refer to the analysis without copying and are valid as
+ * long as it is; sets at an instruction own their bits. Every set must be
+ * released with LiveSetDispose. */
+LiveSetRef LivenessGetLiveIn(LivenessRef L, LLVMBasicBlockRef BB);
+LiveSetRef LivenessGetLiveOut(LivenessRef L, LLVMBasicBlockRef BB);
+LiveSetRef LivenessGetLiveBefore(LivenessRef L, LLVMValueRef Inst);
+LiveSetRef LivenessGetLiveAfter(LivenessRef L, LLVMValueRef Inst);
+void LiveSetDispose(LiveSetRef S);
+
+unsigned LiveSetSize(LiveSetRef S);
+LLVMBool LiveSetContains(LiveSetRef S, unsigned Index);
+/* The first ordinal in S greater than Prev, or -1. Pass -1 to start. */
+int LiveSetNext(LiveSetRef S, int Prev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIVENESS_C_H */
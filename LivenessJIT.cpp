@@ -0,0 +1,158 @@
+//=============================================================================
+// DESCRIPTION:
+//    Benchmark of PressureHintsTransform (see LivenessJIT.h) inside a real
+//    ORC JIT. Every run creates an LLJIT whose IRTransformLayer runs the
+//    transform, adds the module and looks up every defined function, so the
+//    whole module is materialised through the layer. The transform chains to
+//    a second one that reads the hints back with getPressureHints, the way a
+//    tiering decision would, and prints them for the first run:
+//      @f: max pressure 3, avg 1.50
+//    The time spent in the hints is reported next to the time of the whole
+//    materialisation (hints, codegen and linking).
+//
+//    Not part of the plugin, which does not depend on OrcJIT. Built as the
+//    'liveness-jit' tool with -DLIVENESS_BUILD_JIT=ON:
+//      liveness-jit input.ll [-repeat N]
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Parse the module into a fresh context (a ThreadSafeModule is consumed
+//    by the JIT)
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    Create an LLJIT and install the timed transform on its IRTransformLayer
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Add the module and look up every defined function
+//=============================================================================
+#include "LivenessJIT.h"
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+static cl::opt<std::string> InputFilename(cl::Positional,
+                                          cl::desc("<input IR>"),
+                                          cl::init("-"));
+static cl::opt<unsigned> Repeat("repeat",
+                                cl::desc("Number of JIT instances to time"),
+                                cl::init(1));
+
+namespace {
+struct JITStats {
+    TimeRecord HintsTime, MaterializeTime;
+    unsigned Functions = 0, Instructions = 0;
+};
+
+// One JIT instance. Prints the hints to HintsOS, if set.
+Error runJIT(MemoryBufferRef Input, JITStats &Stats, raw_ostream *HintsOS) {
+    // STEP 1: Parse
+    auto Ctx = std::make_unique<LLVMContext>();
+    SMDiagnostic Diag;
+    std::unique_ptr<Module> M = parseIR(Input, Diag, *Ctx);
+    if (!M) {
+        std::string DummyStr;
+        raw_string_ostream DiagStr(DummyStr);
+        Diag.print(nullptr, DiagStr, false);
+        return make_error<StringError>(DiagStr.str(),
+                                       inconvertibleErrorCode());
+    }
+    std::vector<std::string> Names;
+    for (Function &F : *M) {
+        if (F.isDeclaration())
+            continue;
+        Names.push_back(F.getName().str());
+        ++Stats.Functions;
+        Stats.Instructions += F.getInstructionCount();
+    }
+
+    // STEP 2: The hints are timed from the layer's call of the transform
+    // until they are passed on
+    auto ReadHints = [&](ThreadSafeModule TSM, MaterializationResponsibility &)
+            -> Expected<ThreadSafeModule> {
+        Stats.HintsTime += TimeRecord::getCurrentTime(false);
+        if (HintsOS)
+            TSM.withModuleDo([&](Module &M) {
+                for (Function &F : M)
+                    if (auto Hints = liveness::getPressureHints(F))
+                        *HintsOS << format("@%s: max pressure %u, avg %.2f\n",
+                                           F.getName().str().c_str(),
+                                           Hints->MaxPressure,
+                                           Hints->AvgPressure);
+            });
+        return TSM;
+    };
+    liveness::PressureHintsTransform Hints(std::move(ReadHints));
+
+    Expected<std::unique_ptr<LLJIT>> J = LLJITBuilder().create();
+    if (!J)
+        return J.takeError();
+    (*J)->getIRTransformLayer().setTransform(
+            [&](ThreadSafeModule TSM, MaterializationResponsibility &R) {
+                Stats.HintsTime -= TimeRecord::getCurrentTime(true);
+                return Hints(std::move(TSM), R);
+            });
+
+    // STEP 3: Materialise everything
+    Stats.MaterializeTime -= TimeRecord::getCurrentTime(true);
+    if (Error E = (*J)->addIRModule(
+                ThreadSafeModule(std::move(M), std::move(Ctx))))
+        return E;
+    for (const std::string &Name : Names) {
+        Expected<JITEvaluatedSymbol> Sym = (*J)->lookup(Name);
+        if (!Sym)
+            return Sym.takeError();
+    }
+    Stats.MaterializeTime += TimeRecord::getCurrentTime(false);
+    return Error::success();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    InitLLVM X(argc, argv);
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+    cl::ParseCommandLineOptions(argc, argv, "pressure hints in an ORC JIT\n");
+
+    ErrorOr<std::unique_ptr<MemoryBuffer>> Input =
+            MemoryBuffer::getFileOrSTDIN(InputFilename);
+    if (!Input) {
+        errs() << "liveness-jit: cannot read '" << InputFilename
+               << "': " << Input.getError().message() << "\n";
+        return 1;
+    }
+
+    unsigned Runs = std::max(Repeat.getValue(), 1u);
+    JITStats Stats;
+    for (unsigned I = 0; I < Runs; ++I)
+        if (Error E = runJIT(**Input, Stats, I == 0 ? &outs() : nullptr)) {
+            logAllUnhandledErrors(std::move(E), errs(), "liveness-jit: ");
+            return 1;
+        }
+
+    double Hints = Stats.HintsTime.getWallTime();
+    double Total = Stats.MaterializeTime.getWallTime();
+    errs() << format("liveness-jit: %u functions, %u instructions (%u runs)\n",
+                     Stats.Functions / Runs, Stats.Instructions / Runs, Runs);
+    errs() << format("  hints %.3f ms of %.3f ms materialisation (%.1f%%)\n",
+                     Hints * 1000.0, Total * 1000.0,
+                     Total ? Hints / Total * 100.0 : 0.0);
+    errs() << format("  hints per function %.1f us, per instruction %.1f ns\n",
+                     Stats.Functions ? Hints / Stats.Functions * 1e6 : 0.0,
+                     Stats.Instructions ? Hints / Stats.Instructions * 1e9
+                                        : 0.0);
+    return 0;
+}
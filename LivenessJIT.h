@@ -0,0 +1,55 @@
+//=============================================================================
+// DESCRIPTION:
+//    ORC JIT integration. PressureHintsTransform is a transform for an
+//    IRTransformLayer: every module the layer materialises gets pressure
+//    hints attached to its functions (see PressureHints in Liveness.h), so
+//    liveness is only computed for code that is actually compiled, once per
+//    function. Place the layer below the one that picks the optimisation
+//    level, which reads the hints back with getPressureHints:
+//
+//      IRTransformLayer HintsLayer(ES, OptimizeLayer,
+//                                  liveness::PressureHintsTransform());
+//
+//    or, with LLJIT's single transform layer in front of the optimiser:
+//
+//      J->getIRTransformLayer().setTransform(
+//              liveness::PressureHintsTransform(Optimize));
+//
+//    This header is self-contained so that the plugin itself does not
+//    depend on OrcJIT; clients link the JIT libraries as usual. The
+//    liveness-jit benchmark (LivenessJIT.cpp) runs the transform in an LLJIT.
+//=============================================================================
+#ifndef LIVENESS_JIT_H
+#define LIVENESS_JIT_H
+
+#include "Liveness.h"
+
+#include "llvm/ExecutionEngine/Orc/IRTransformLayer.h"
+
+namespace liveness {
+
+class PressureHintsTransform {
+public:
+    using TransformFn = llvm::orc::IRTransformLayer::TransformFunction;
+
+    // Next, if set, runs on the annotated module (e.g. the optimiser)
+    explicit PressureHintsTransform(TransformFn Next = nullptr)
+            : Next(std::move(Next)) {}
+
+    // The responsibility is const-qualified in older ORC versions
+    template <typename ResponsibilityT>
+    llvm::Expected<llvm::orc::ThreadSafeModule>
+    operator()(llvm::orc::ThreadSafeModule TSM, ResponsibilityT &R) {
+        TSM.withModuleDo([](llvm::Module &M) { annotatePressureHints(M); });
+        if (Next)
+            return Next(std::move(TSM), R);
+        return TSM;
+    }
+
+private:
+    TransformFn Next;
+};
+
+} // namespace liveness
+
+#endif // LIVENESS_JIT_H
@@ -0,0 +1,183 @@
+//=============================================================================
+// DESCRIPTION:
+//    Serialisation of LiveSets into function metadata, so that later passes
+//    and separate tools reuse the result instead of recomputing it:
+//
+//      define void @f(...) !liveness.live-in !0
+//      !0 = !{i64 <fingerprint>, i64 <values>, [K x i64] [<live-in words>]}
+//
+//    The live-in set of every block, in layout order, is stored as a bitset
+//    of value ordinals in ceil(values / 64) 64-bit words. The fingerprint
+//    hashes everything the result depends on (the CFG, the def-use graph in
+//    terms of ordinals and the instruction opcodes and types), so a loader
+//    notices when the function was changed after the sets were attached.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Number the values and collect the phi operands per edge, exactly as
+//    the solver does (see LiveSets.cpp, STEPs 1 and 2)
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    Compare the stored fingerprint and value count with the function's
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Read the live-in sets; LiveOut_N is the union over the successors S of
+//    LiveIn_S  U  PhiUses_{S <- N}, so no iteration is needed
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+constexpr const char *LiveInMDName = "liveness.live-in";
+
+unsigned getNumWords(unsigned NumValues) { return (NumValues + 63) / 64; }
+
+// STEP 2: Hash of the structure the live sets are computed from
+uint64_t getFingerprint(const LiveSets &LS) {
+    Function &F = LS.getFunction();
+    DenseMap<const BasicBlock *, unsigned> BlockIdx;
+    for (const BasicBlock &BB : F) {
+        // operator[] may insert before size() is read
+        unsigned Idx = BlockIdx.size();
+        BlockIdx[&BB] = Idx;
+    }
+
+    SmallVector<uint64_t, 256> Data;
+    Data.push_back(LS.getNumValues());
+    Data.push_back(F.size());
+    auto AddOperand = [&](const Value *V) {
+        if (auto *BB = dyn_cast<BasicBlock>(V))
+            Data.push_back((uint64_t(1) << 32) | BlockIdx.lookup(BB));
+        else
+            // Untracked operands (constants, globals) are all alike
+            Data.push_back(uint32_t(LS.getIndex(V)));
+    };
+    for (const BasicBlock &BB : F) {
+        Data.push_back(BB.size());
+        for (const Instruction &Inst : BB) {
+            Data.push_back(Inst.getOpcode());
+            Data.push_back(Inst.getType()->getTypeID());
+            Data.push_back(Inst.getNumOperands());
+            for (const Value *Op : Inst.operands())
+                AddOperand(Op);
+            if (auto *Phi = dyn_cast<PHINode>(&Inst))
+                for (const BasicBlock *In : Phi->blocks())
+                    AddOperand(In);
+            if (auto *AI = dyn_cast<AllocaInst>(&Inst))
+                Data.push_back(AI->isStaticAlloca());
+        }
+    }
+    return xxHash64(StringRef(reinterpret_cast<const char *>(Data.data()),
+                              Data.size() * sizeof(uint64_t)));
+}
+
+uint64_t getConstantInt(const MDOperand &Op) {
+    auto *C = mdconst::dyn_extract_or_null<ConstantInt>(Op);
+    return C ? C->getZExtValue() : ~uint64_t(0);
+}
+} // namespace
+
+void LiveSets::attachMetadata() const {
+    unsigned NumWords = getNumWords(getNumValues());
+    std::vector<uint64_t> Words(NumWords * F->size(), 0);
+    unsigned Offset = 0;
+    for (const BasicBlock &BB : *F) {
+        for (unsigned Idx : getLiveIn(&BB).set_bits())
+            Words[Offset + Idx / 64] |= uint64_t(1) << (Idx % 64);
+        Offset += NumWords;
+    }
+
+    LLVMContext &Ctx = F->getContext();
+    Type *Int64Ty = Type::getInt64Ty(Ctx);
+    Metadata *Ops[] = {
+            ConstantAsMetadata::get(
+                    ConstantInt::get(Int64Ty, getFingerprint(*this))),
+            ConstantAsMetadata::get(ConstantInt::get(Int64Ty, getNumValues())),
+            ConstantAsMetadata::get(ConstantDataArray::get(Ctx, Words))};
+    F->setMetadata(LiveInMDName, MDTuple::get(Ctx, Ops));
+}
+
+Optional<LiveSets> LiveSets::loadMetadata(Function &F) {
+    auto *MD = dyn_cast_or_null<MDTuple>(F.getMetadata(LiveInMDName));
+    if (!MD || MD->getNumOperands() != 3)
+        return None;
+
+    // STEP 1: Numbering and phi operands
+    LiveSets LS;
+    LS.F = &F;
+    LS.numberValues();
+    LS.computeLocalSets();
+
+    // STEP 2: Is the metadata still valid?
+    unsigned NumValues = LS.getNumValues();
+    unsigned NumWords = getNumWords(NumValues);
+    auto *Words = mdconst::dyn_extract_or_null<Constant>(MD->getOperand(2));
+    auto *WordsTy = Words ? dyn_cast<ArrayType>(Words->getType()) : nullptr;
+    if (!WordsTy || !WordsTy->getElementType()->isIntegerTy(64) ||
+        WordsTy->getNumElements() != uint64_t(NumWords) * F.size() ||
+        getConstantInt(MD->getOperand(1)) != NumValues ||
+        getConstantInt(MD->getOperand(0)) != getFingerprint(LS))
+        return None;
+
+    // STEP 3: Live-ins from the metadata, live-outs from the live-ins. An
+    // all-zero array is stored as zeroinitializer.
+    auto *Data = dyn_cast<ConstantDataArray>(Words);
+    unsigned Offset = 0;
+    for (const BasicBlock &BB : F) {
+        BitVector &LiveIn = LS.Blocks.find(&BB)->second.LiveIn;
+        for (unsigned W = 0; Data && W != NumWords; ++W) {
+            uint64_t Word = Data->getElementAsInteger(Offset + W);
+            for (; Word; Word &= Word - 1)
+                LiveIn.set(W * 64 + countTrailingZeros(Word));
+        }
+        Offset += NumWords;
+    }
+    for (const BasicBlock &BB : F) {
+        BitVector &LiveOut = LS.Blocks.find(&BB)->second.LiveOut;
+        for (const BasicBlock *Succ : successors(&BB)) {
+            LiveOut |= LS.Blocks.find(Succ)->second.LiveIn;
+            auto It = LS.PhiUses.find({&BB, Succ});
+            if (It != LS.PhiUses.end())
+                LiveOut |= It->second;
+        }
+    }
+    return LS;
+}
+
+//-----------------------------------------------------------------------------
+// attach-liveness
+//-----------------------------------------------------------------------------
+PreservedAnalyses AttachLivenessPass::run(Function &F,
+                                          FunctionAnalysisManager &) {
+    Optional<LiveSets> LS = LiveSets::loadMetadata(F);
+    bool Reused = LS.hasValue();
+    if (!Reused)
+        LS.emplace(F);
+
+    errs() << format("attach-liveness @%s: %u values, %u blocks, %s",
+                     F.getName().str().c_str(), LS->getNumValues(),
+                     static_cast<unsigned>(F.size()),
+                     Reused ? "reused" : "computed");
+    if (Verify && Reused)
+        errs() << (LS->isSameAs(LiveSets(F)) ? ", verified"
+                                              : ", SETS DIFFER");
+    errs() << "\n";
+
+    LS->attachMetadata();
+    // Only metadata changes
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
@@ -0,0 +1,225 @@
+//=============================================================================
+// DESCRIPTION:
+//    Module-wide liveness statistics from a sample of the functions. The
+//    functions are split into strata of similar size, a deterministic random
+//    subset of every stratum is analysed, and the per-function statistics
+//    are extrapolated to the module with 95% confidence intervals (stratified
+//    random sampling without replacement). With rate=1 every function is
+//    analysed and the intervals are empty.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    N_h, n_h = functions in stratum h and sampled from it, W_h = N_h / N
+//    y_hi     = a statistic of the i-th sampled function of stratum h
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Sort the functions by block count and cut them into equally sized
+//    strata. In every stratum pick the n_h = max(2, rate * N_h) functions
+//    with the smallest hash of (seed, name).
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    For every sampled function compute the average and maximum pressure
+//    over its program points, the average live-in size of its blocks and a
+//    histogram of those sizes
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Mean  = sum_h W_h * mean_h(y)
+//    Var   = sum_h W_h^2 * (1 - n_h / N_h) * s_h^2 / n_h
+//    CI    = Mean +- 1.96 * sqrt(Var)
+//    Histogram buckets are scaled by N_h / n_h per stratum
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+#include <cmath>
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+// Upper bounds of the live-in size buckets; the last one is open
+constexpr unsigned BucketLimits[] = {0, 2, 4, 8, 16, 32};
+constexpr unsigned NumBuckets = array_lengthof(BucketLimits) + 1;
+
+struct FunctionStats {
+    double AvgPressure = 0.0;
+    double MaxPressure = 0.0;
+    double AvgLiveIn = 0.0;
+    unsigned Buckets[NumBuckets] = {};
+};
+
+struct Stratum {
+    std::vector<Function *> Funcs;
+    std::vector<FunctionStats> Sample;
+};
+
+unsigned getBucket(unsigned Size) {
+    for (unsigned B = 0; B != NumBuckets - 1; ++B)
+        if (Size <= BucketLimits[B])
+            return B;
+    return NumBuckets - 1;
+}
+
+// STEP 2: Statistics of one function
+FunctionStats computeStats(const LiveSets &LS) {
+    FunctionStats Stats;
+    Function &F = LS.getFunction();
+    uint64_t Points = 0, PressureSum = 0, LiveInSum = 0;
+    unsigned Max = 0;
+    for (const BasicBlock &BB : F) {
+        unsigned LiveIn = LS.getLiveIn(&BB).count();
+        LiveInSum += LiveIn;
+        ++Stats.Buckets[getBucket(LiveIn)];
+        LS.walkBlockBackward(BB, [&](const Instruction &,
+                                     const BitVector &Live) {
+            unsigned P = LS.getPressure(Live);
+            PressureSum += P;
+            Max = std::max(Max, P);
+            ++Points;
+        });
+    }
+    Stats.AvgPressure = Points ? double(PressureSum) / Points : 0.0;
+    Stats.MaxPressure = Max;
+    Stats.AvgLiveIn = F.empty() ? 0.0 : double(LiveInSum) / F.size();
+    return Stats;
+}
+
+// STEP 3: Stratified estimate of the mean of Get over all functions and
+// the half-width of its 95% confidence interval
+template <typename GetTy>
+std::pair<double, double> estimateMean(ArrayRef<Stratum> Strata,
+                                       unsigned Total, GetTy Get) {
+    double Mean = 0.0, Var = 0.0;
+    for (const Stratum &S : Strata) {
+        double N = S.Funcs.size(), n = S.Sample.size();
+        if (!n)
+            continue;
+        double W = N / Total, Sum = 0.0, SumSq = 0.0;
+        for (const FunctionStats &FS : S.Sample) {
+            Sum += Get(FS);
+            SumSq += Get(FS) * Get(FS);
+        }
+        double M = Sum / n;
+        Mean += W * M;
+        if (n > 1) {
+            double S2 = (SumSq - n * M * M) / (n - 1);
+            Var += W * W * (1.0 - n / N) * std::max(S2, 0.0) / n;
+        }
+    }
+    return {Mean, 1.96 * std::sqrt(Var)};
+}
+} // namespace
+
+PreservedAnalyses LivenessStatsPass::run(Module &M,
+                                         ModuleAnalysisManager &MAM) {
+    auto &FAM = MAM.getResult<FunctionAnalysisManagerModuleProxy>(M)
+                        .getManager();
+
+    // STEP 1: Strata and the sample
+    std::vector<Function *> Funcs;
+    for (Function &F : M)
+        if (!F.isDeclaration())
+            Funcs.push_back(&F);
+    if (Funcs.empty())
+        return PreservedAnalyses::all();
+    llvm::sort(Funcs, [](const Function *A, const Function *B) {
+        if (A->size() != B->size())
+            return A->size() < B->size();
+        return A->getName() < B->getName();
+    });
+
+    unsigned NumStrata = std::max(1u, std::min<unsigned>(Strata, Funcs.size()));
+    std::vector<Stratum> Groups(NumStrata);
+    for (unsigned I = 0, E = Funcs.size(); I != E; ++I)
+        Groups[uint64_t(I) * NumStrata / E].Funcs.push_back(Funcs[I]);
+
+    auto Hash = [&](const Function *F) {
+        return xxHash64((Twine(Seed) + ":" + F->getName()).str());
+    };
+    unsigned Sampled = 0;
+    for (Stratum &S : Groups) {
+        std::vector<Function *> Order = S.Funcs;
+        llvm::sort(Order, [&](const Function *A, const Function *B) {
+            return Hash(A) < Hash(B);
+        });
+        size_t N = Order.size();
+        size_t n = std::min<size_t>(
+                N, std::max<size_t>(2, std::ceil(Rate * N)));
+        for (size_t I = 0; I != n; ++I)
+            S.Sample.push_back(
+                    computeStats(FAM.getResult<LiveSetsAnalysis>(*Order[I])));
+        Sampled += n;
+    }
+
+    // STEP 3: Extrapolate
+    unsigned Total = Funcs.size();
+    auto AvgP = estimateMean(Groups, Total, [](const FunctionStats &FS) {
+        return FS.AvgPressure;
+    });
+    auto MaxP = estimateMean(Groups, Total, [](const FunctionStats &FS) {
+        return FS.MaxPressure;
+    });
+    auto LiveIn = estimateMean(Groups, Total, [](const FunctionStats &FS) {
+        return FS.AvgLiveIn;
+    });
+    double Buckets[NumBuckets] = {}, Blocks = 0.0;
+    double PeakSeen = 0.0;
+    for (const Stratum &S : Groups) {
+        double Scale = double(S.Funcs.size()) / S.Sample.size();
+        for (const FunctionStats &FS : S.Sample) {
+            for (unsigned B = 0; B != NumBuckets; ++B) {
+                Buckets[B] += Scale * FS.Buckets[B];
+                Blocks += Scale * FS.Buckets[B];
+            }
+            PeakSeen = std::max(PeakSeen, FS.MaxPressure);
+        }
+    }
+
+    raw_ostream &OutS = errs();
+    OutS << "=================================================\n";
+    OutS << format("Liveness statistics (%u of %u functions sampled, %u "
+                   "strata)\n",
+                   Sampled, Total, NumStrata);
+    OutS << "=================================================\n";
+    for (unsigned H = 0; H != NumStrata; ++H) {
+        const Stratum &S = Groups[H];
+        OutS << format("stratum %u: %u-%u blocks, %u functions, %u sampled\n",
+                       H, static_cast<unsigned>(S.Funcs.front()->size()),
+                       static_cast<unsigned>(S.Funcs.back()->size()),
+                       static_cast<unsigned>(S.Funcs.size()),
+                       static_cast<unsigned>(S.Sample.size()));
+    }
+    OutS << "-------------------------------------------------\n";
+    OutS << format("average pressure:     %8.2f +- %.2f\n", AvgP.first,
+                   AvgP.second);
+    OutS << format("max pressure:         %8.2f +- %.2f\n", MaxP.first,
+                   MaxP.second);
+    OutS << format("live-in per block:    %8.2f +- %.2f\n", LiveIn.first,
+                   LiveIn.second);
+    OutS << format("highest pressure seen: %u\n",
+                   static_cast<unsigned>(PeakSeen));
+    OutS << format("live-in size distribution (%.0f blocks):\n", Blocks);
+    for (unsigned B = 0; B != NumBuckets; ++B) {
+        std::string DummyStr;
+        raw_string_ostream RangeStr(DummyStr);
+        unsigned Low = B ? BucketLimits[B - 1] + 1 : 0;
+        if (B == NumBuckets - 1)
+            RangeStr << Low << "+";
+        else if (Low == BucketLimits[B])
+            RangeStr << Low;
+        else
+            RangeStr << Low << "-" << BucketLimits[B];
+        OutS << format("==>%-6s %6.1f%%\n", RangeStr.str().c_str(),
+                       Blocks ? 100.0 * Buckets[B] / Blocks : 0.0);
+    }
+    OutS << "-------------------------------------------------\n\n";
+
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
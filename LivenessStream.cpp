@@ -0,0 +1,166 @@
+//=============================================================================
+// DESCRIPTION:
+//    Module-wide RIV dump that never holds more than one function body in
+//    memory. The module is loaded lazily: only globals and function
+//    declarations are read up front, bodies stay in the (memory-mapped)
+//    bitcode until they are materialized. Every function is materialized,
+//    analysed, written out and deleted again before the next one, so peak
+//    memory follows the largest function rather than the module.
+//
+//    The output is the same as 'liveness-dump' writes for the whole module.
+//    Textual IR cannot be loaded lazily and is parsed in full.
+//
+//    Built as the 'liveness-stream' tool with -DLIVENESS_BUILD_STREAM=ON:
+//      liveness-stream input.bc [-o output]
+//      liveness-stream -batch [-j N] [-numa=false] [-o dir] a.bc b.bc ...
+//      liveness-stream -bench [-j N] a.bc b.bc ...
+//    The batch modes are implemented in LivenessBatch.cpp.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Read the module lazily, with metadata loaded on demand
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    For every function F, in module order: materialize F, build its
+//    dominator tree and RIV, print the result and delete F's body
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#ifdef LIVENESS_STREAM_TOOL
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/ToolOutputFile.h"
+#endif
+
+using namespace llvm;
+
+namespace liveness {
+
+Expected<StreamStats> streamRIV(StringRef Path, raw_ostream &OS) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+            MemoryBuffer::getFileOrSTDIN(Path);
+    if (!Buffer)
+        return createFileError(Path, Buffer.getError());
+    return streamRIV(std::move(*Buffer), OS);
+}
+
+Expected<StreamStats> streamRIV(std::unique_ptr<MemoryBuffer> Buffer,
+                                raw_ostream &OS) {
+    // STEP 1: Globals and declarations only
+    LLVMContext Ctx;
+    SMDiagnostic Diag;
+    std::unique_ptr<Module> M =
+            getLazyIRModule(std::move(Buffer), Diag, Ctx,
+                            /*ShouldLazyLoadMetadata=*/true);
+    if (!M) {
+        std::string DummyStr;
+        raw_string_ostream DiagStr(DummyStr);
+        Diag.print(nullptr, DiagStr, false);
+        return make_error<StringError>(DiagStr.str(),
+                                       inconvertibleErrorCode());
+    }
+
+    // STEP 2: One function at a time
+    StreamStats Stats;
+    for (Function &F : *M) {
+        if (Error E = F.materialize())
+            return E;
+        if (F.isDeclaration())
+            continue;
+
+        size_t NumInsts = 0;
+        for (const BasicBlock &BB : F)
+            NumInsts += BB.size();
+        Stats.MaxInstructions = std::max(Stats.MaxInstructions, NumInsts);
+        ++Stats.Functions;
+
+        {
+            DominatorTree DT(F);
+            printRIV(OS, buildRIV(F, DT));
+        }
+        // Calls to F keep referring to the (now empty) function
+        F.deleteBody();
+    }
+    return Stats;
+}
+
+} // namespace liveness
+
+#ifdef LIVENESS_STREAM_TOOL
+static cl::list<std::string> InputFilenames(cl::Positional,
+                                            cl::desc("<input bitcode>..."));
+static cl::opt<std::string> OutputFilename(
+        "o", cl::desc("Output file (output directory with -batch)"),
+        cl::value_desc("filename"));
+static cl::opt<bool> Batch("batch",
+                           cl::desc("Write the result for every input X "
+                                    "to X.riv (or to the -o directory)"));
+static cl::opt<unsigned> Threads("j",
+                                 cl::desc("Batch workers (0: one per CPU)"),
+                                 cl::init(0));
+static cl::opt<bool> Numa("numa", cl::desc("Pin batch workers per NUMA node"),
+                          cl::init(true));
+static cl::opt<bool> Bench("bench",
+                           cl::desc("Time the batch with 1, 2, 4, ... -j "
+                                    "workers, with and without -numa"));
+
+int main(int argc, char **argv) {
+    InitLLVM X(argc, argv);
+    cl::ParseCommandLineOptions(argc, argv,
+                                "streaming reachable values dump\n");
+
+    if (Bench) {
+        liveness::benchBatch(InputFilenames, Threads, outs());
+        return 0;
+    }
+    if (Batch) {
+        liveness::BatchOptions Opts;
+        Opts.Threads = Threads;
+        Opts.Numa = Numa;
+        Opts.OutputDir = OutputFilename;
+        liveness::BatchStats Stats = liveness::runBatch(InputFilenames, Opts);
+        errs() << format("liveness-stream: %u modules (%u failed) on %u "
+                         "threads, %u nodes, %.3f s\n",
+                         Stats.Modules, Stats.Failed, Stats.Threads,
+                         Stats.Nodes, Stats.Seconds);
+        return Stats.Failed ? 1 : 0;
+    }
+
+    if (InputFilenames.size() > 1) {
+        errs() << "liveness-stream: several inputs need -batch\n";
+        return 1;
+    }
+    std::string Input = InputFilenames.empty() ? "-" : InputFilenames[0];
+    std::string Output =
+            OutputFilename.empty() ? "-" : OutputFilename.getValue();
+    std::error_code EC;
+    ToolOutputFile Out(Output, EC, sys::fs::OF_None);
+    if (EC) {
+        errs() << "liveness-stream: cannot open '" << Output
+               << "': " << EC.message() << "\n";
+        return 1;
+    }
+    Expected<liveness::StreamStats> Stats =
+            liveness::streamRIV(Input, Out.os());
+    if (!Stats) {
+        logAllUnhandledErrors(Stats.takeError(), errs(), "liveness-stream: ");
+        return 1;
+    }
+    Out.keep();
+    errs() << format("liveness-stream: %u functions, largest %zu "
+                     "instructions\n",
+                     Stats->Functions, Stats->MaxInstructions);
+    return 0;
+}
+#endif
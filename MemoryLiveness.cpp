@@ -0,0 +1,373 @@
+//=============================================================================
+// DESCRIPTION:
+//    Memory liveness: which stored memory states are live at each block, and
+//    which stores are never observed on any path (dead stores). The memory
+//    accesses of every block are taken from MemorySSA, so instructions that
+//    alias analysis proves not to touch memory are ignored; every underlying
+//    object (alloca, global, argument, ...) is then analysed on its own, in
+//    parallel.
+//
+//    A store s to object O is live at a point p if s reaches p without being
+//    overwritten and some path from p reads the bytes of s before they are
+//    overwritten. An access through a pointer that may be based on several
+//    objects (a select or phi of pointers) counts as an imprecise access to
+//    each of them. Reads through unknown pointers and calls read every object
+//    that is not a non-escaping alloca; objects other than allocas are also
+//    read by the caller after the function returns or unwinds.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    Loc = (object, constant offset, size); unknown offsets or sizes overlap
+//    everything and overwrite nothing
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Walk the MemorySSA access lists and classify every access as a write,
+//    a read or a read of everything, with its Loc
+//    -------------------------------------------------------------------------
+//    STEP 2 (per object, in parallel):
+//    Number the stores to the object and solve two bit-vector problems over
+//    them: backward "will be read" and forward "reaches"
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Live memory at the entry of BB_N is WillBeRead_N & Reaches_N. A store
+//    is dead if it will not be read right after it executes.
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/ADT/SetVector.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/CaptureTracking.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <deque>
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+struct MemLoc {
+    const Value *Obj = nullptr;
+    int64_t Offset = 0;
+    uint64_t Size = 0;
+    bool Precise = false;
+
+    bool covers(const MemLoc &Other) const {
+        return Precise && Other.Precise && Obj == Other.Obj &&
+               Offset <= Other.Offset &&
+               Other.Offset + Other.Size <= Offset + Size;
+    }
+    bool overlaps(const MemLoc &Other) const {
+        if (Obj != Other.Obj)
+            return false;
+        if (!Precise || !Other.Precise)
+            return true;
+        return Offset < Other.Offset + int64_t(Other.Size) &&
+               Other.Offset < Offset + int64_t(Size);
+    }
+};
+
+struct MemAccess {
+    enum KindTy { Write, Read, ReadAny, KillObject } Kind;
+    MemLoc Loc;
+    const Instruction *Inst;
+};
+
+using AccessMapTy = DenseMap<const BasicBlock *, std::vector<MemAccess>>;
+
+// The objects Ptr may be based on, looking through any number of selects,
+// phis and address computations
+SmallVector<const Value *, 2> getObjects(const Value *Ptr) {
+    SmallVector<const Value *, 2> Objs;
+    getUnderlyingObjects(Ptr, Objs, nullptr, /*MaxLookup=*/0);
+    return Objs;
+}
+
+// Adds an access of Kind to every object Ptr may be based on; it is only
+// precise if there is one
+void addAccess(std::vector<MemAccess> &List, MemAccess::KindTy Kind,
+               const Value *Ptr, Optional<uint64_t> Size,
+               const Instruction *I, const DataLayout &DL) {
+    SmallVector<const Value *, 2> Objs = getObjects(Ptr);
+    for (const Value *Obj : Objs) {
+        MemLoc Loc;
+        Loc.Obj = Obj;
+        int64_t Offset = 0;
+        const Value *Base = GetPointerBaseWithConstantOffset(Ptr, Offset, DL);
+        if (Objs.size() == 1 && Base == Obj && Size) {
+            Loc.Offset = Offset;
+            Loc.Size = *Size;
+            Loc.Precise = true;
+        }
+        List.push_back({Kind, Loc, I});
+    }
+}
+
+// STEP 1: Classify the memory accesses of F
+AccessMapTy collectAccesses(Function &F, MemorySSA &MSSA) {
+    const DataLayout &DL = F.getParent()->getDataLayout();
+    AccessMapTy Accesses;
+    for (BasicBlock &BB : F) {
+        auto &List = Accesses[&BB];
+        const MemorySSA::AccessList *MAs = MSSA.getBlockAccesses(&BB);
+        if (!MAs)
+            continue;
+        for (const MemoryAccess &MA : *MAs) {
+            // Memory phis only merge the states of the predecessors
+            auto *MUD = dyn_cast<MemoryUseOrDef>(&MA);
+            if (!MUD)
+                continue;
+            Instruction *I = MUD->getMemoryInst();
+            if (auto *SI = dyn_cast<StoreInst>(I)) {
+                uint64_t Size =
+                        DL.getTypeStoreSize(SI->getValueOperand()->getType());
+                addAccess(List, MemAccess::Write, SI->getPointerOperand(),
+                          Size, I, DL);
+            } else if (auto *LI = dyn_cast<LoadInst>(I)) {
+                uint64_t Size = DL.getTypeStoreSize(LI->getType());
+                addAccess(List, MemAccess::Read, LI->getPointerOperand(), Size,
+                          I, DL);
+            } else if (isa<IntrinsicInst>(I) &&
+                       cast<IntrinsicInst>(I)->getIntrinsicID() ==
+                               Intrinsic::lifetime_end) {
+                // Only ends the lifetime of a single known object
+                SmallVector<const Value *, 2> Objs =
+                        getObjects(I->getOperand(1));
+                if (Objs.size() == 1)
+                    addAccess(List, MemAccess::KillObject, I->getOperand(1),
+                              None, I, DL);
+            } else if (auto *MI = dyn_cast<MemIntrinsic>(I)) {
+                Optional<uint64_t> Size;
+                if (auto *Len = dyn_cast<ConstantInt>(MI->getLength()))
+                    Size = Len->getZExtValue();
+                if (auto *MTI = dyn_cast<MemTransferInst>(MI))
+                    addAccess(List, MemAccess::Read, MTI->getSource(), Size,
+                              I, DL);
+                addAccess(List, MemAccess::Write, MI->getDest(), Size, I, DL);
+            } else if (I->mayReadFromMemory()) {
+                List.push_back({MemAccess::ReadAny, MemLoc(), I});
+            }
+        }
+    }
+    return Accesses;
+}
+
+// Blocks that leave the function: the caller observes memory after a return
+// or an unwind, but not after unreachable
+bool isFunctionExit(const BasicBlock *BB) {
+    const Instruction *Term = BB->getTerminator();
+    return succ_empty(BB) && !isa<UnreachableInst>(Term);
+}
+
+struct ObjectResult {
+    const Value *Obj;
+    std::vector<const Instruction *> Stores;
+    DenseMap<const BasicBlock *, BitVector> LiveIn;
+    BitVector Dead;
+};
+
+// STEP 2 and 3 for one object
+ObjectResult analyseObject(Function &F, const Value *Obj, bool IsVisible,
+                           const AccessMapTy &Accesses) {
+    ObjectResult Result;
+    Result.Obj = Obj;
+
+    // Number the stores to Obj
+    DenseMap<const MemAccess *, unsigned> StoreId;
+    std::vector<MemLoc> StoreLocs;
+    for (const BasicBlock &BB : F)
+        for (const MemAccess &A : Accesses.find(&BB)->second)
+            if (A.Kind == MemAccess::Write && A.Loc.Obj == Obj) {
+                StoreId[&A] = Result.Stores.size();
+                Result.Stores.push_back(A.Inst);
+                StoreLocs.push_back(A.Loc);
+            }
+    unsigned NumStores = Result.Stores.size();
+
+    // Effect of A on the stores to Obj
+    // Calls read Obj if it escaped or if it is passed to them directly
+    auto PassedTo = [&](const Instruction *I) {
+        return any_of(I->operands(), [&](const Value *Op) {
+            return Op->getType()->isPointerTy() &&
+                   is_contained(getObjects(Op), Obj);
+        });
+    };
+    auto Reads = [&](const MemAccess &A, BitVector &Set) {
+        if ((A.Kind == MemAccess::ReadAny &&
+             (IsVisible || PassedTo(A.Inst))) ||
+            (A.Kind == MemAccess::Read && A.Loc.Obj != Obj &&
+             !isIdentifiedObject(A.Loc.Obj) && IsVisible)) {
+            Set.set();
+            return;
+        }
+        if (A.Kind != MemAccess::Read)
+            return;
+        for (unsigned S = 0; S != NumStores; ++S)
+            if (A.Loc.overlaps(StoreLocs[S]))
+                Set.set(S);
+    };
+    auto Kills = [&](const MemAccess &A, BitVector &Set) {
+        if (A.Kind == MemAccess::KillObject && A.Loc.Obj == Obj) {
+            Set.reset();
+            return;
+        }
+        if (A.Kind != MemAccess::Write)
+            return;
+        for (unsigned S = 0; S != NumStores; ++S)
+            if (A.Loc.covers(StoreLocs[S]))
+                Set.reset(S);
+    };
+
+    // Backward: stores whose bytes will be read. Objects visible to the
+    // caller are read after every exit (return or resume).
+    BitVector All(NumStores, true);
+    DenseMap<const BasicBlock *, BitVector> WillBeRead, Reaches;
+    auto TransferBack = [&](const BasicBlock *BB, BitVector Live,
+                            BitVector *Dead) {
+        auto &List = Accesses.find(BB)->second;
+        for (const MemAccess &A : reverse(List)) {
+            auto It = StoreId.find(&A);
+            if (Dead && It != StoreId.end() && !Live.test(It->second))
+                Dead->set(It->second);
+            Kills(A, Live);
+            Reads(A, Live);
+        }
+        return Live;
+    };
+    auto LiveOutOf = [&](const BasicBlock *BB) {
+        BitVector Out(NumStores);
+        if (IsVisible && isFunctionExit(BB))
+            Out = All;
+        for (const BasicBlock *Succ : successors(BB))
+            Out |= WillBeRead[Succ];
+        return Out;
+    };
+    for (const BasicBlock &BB : F) {
+        WillBeRead[&BB] = BitVector(NumStores);
+        Reaches[&BB] = BitVector(NumStores);
+    }
+    std::deque<const BasicBlock *> Worklist;
+    for (const BasicBlock &BB : F)
+        Worklist.push_front(&BB);
+    while (!Worklist.empty()) {
+        const BasicBlock *BB = Worklist.front();
+        Worklist.pop_front();
+        BitVector In = TransferBack(BB, LiveOutOf(BB), nullptr);
+        if (In == WillBeRead[BB])
+            continue;
+        WillBeRead[BB] = std::move(In);
+        for (const BasicBlock *Pred : predecessors(BB))
+            Worklist.push_back(Pred);
+    }
+
+    // Forward: stores that reach the entry of a block
+    for (const BasicBlock &BB : F)
+        Worklist.push_back(&BB);
+    while (!Worklist.empty()) {
+        const BasicBlock *BB = Worklist.front();
+        Worklist.pop_front();
+        BitVector Out = Reaches[BB];
+        for (const MemAccess &A : Accesses.find(BB)->second) {
+            Kills(A, Out);
+            auto It = StoreId.find(&A);
+            if (It != StoreId.end())
+                Out.set(It->second);
+        }
+        for (const BasicBlock *Succ : successors(BB)) {
+            BitVector &In = Reaches[Succ];
+            BitVector Old = In;
+            In |= Out;
+            if (In != Old)
+                Worklist.push_back(Succ);
+        }
+    }
+
+    // STEP 3: Combine
+    Result.Dead = BitVector(NumStores);
+    for (const BasicBlock &BB : F) {
+        TransferBack(&BB, LiveOutOf(&BB), &Result.Dead);
+        BitVector Live = WillBeRead[&BB];
+        Live &= Reaches[&BB];
+        Result.LiveIn[&BB] = std::move(Live);
+    }
+    return Result;
+}
+
+void printMemoryLivenessResult(raw_ostream &OutS, Function &F,
+                               ArrayRef<ObjectResult> Results) {
+    OutS << "=================================================\n";
+    OutS << "Memory liveness for function " << F.getName() << "\n";
+    OutS << "=================================================\n";
+    for (auto const &R : Results) {
+        std::string DummyStr;
+        raw_string_ostream ObjStr(DummyStr);
+        R.Obj->printAsOperand(ObjStr, false);
+        OutS << format("[[Object %s]] %u stores\n", ObjStr.str().c_str(),
+                       static_cast<unsigned>(R.Stores.size()));
+        for (unsigned S = 0, E = R.Stores.size(); S != E; ++S) {
+            std::string DummyStr;
+            raw_string_ostream InstrStr(DummyStr);
+            R.Stores[S]->print(InstrStr);
+            // Dead stores are marked with '=>x'
+            const char *Marker = R.Dead.test(S) ? "=>x" : "==>";
+            OutS << format("%s#%u%s\n", Marker, S, InstrStr.str().c_str());
+        }
+        for (const BasicBlock &BB : F) {
+            const BitVector &Live = R.LiveIn.find(&BB)->second;
+            if (Live.none())
+                continue;
+            std::string DummyStr;
+            raw_string_ostream BBIdStream(DummyStr);
+            BB.printAsOperand(BBIdStream, false);
+            OutS << "  live into " << BBIdStream.str() << ":";
+            for (unsigned S : Live.set_bits())
+                OutS << " #" << S;
+            OutS << "\n";
+        }
+        OutS << "-------------------------------------------------\n";
+    }
+    OutS << "\n";
+}
+} // namespace
+
+PreservedAnalyses MemoryLivenessPass::run(Function &F,
+                                          FunctionAnalysisManager &FAM) {
+    MemorySSA &MSSA = FAM.getResult<MemorySSAAnalysis>(F).getMSSA();
+    AccessMapTy Accesses = collectAccesses(F, MSSA);
+
+    // One task per stored-to object. Capture analysis is done up front so
+    // the tasks only read the IR.
+    SetVector<const Value *> Objects;
+    for (const BasicBlock &BB : F)
+        for (const MemAccess &A : Accesses[&BB])
+            if (A.Kind == MemAccess::Write)
+                Objects.insert(A.Loc.Obj);
+    std::vector<bool> Visible;
+    for (const Value *Obj : Objects)
+        Visible.push_back(!isa<AllocaInst>(Obj) ||
+                          PointerMayBeCaptured(Obj, /*ReturnCaptures=*/true,
+                                               /*StoreCaptures=*/true));
+
+    std::vector<ObjectResult> Results(Objects.size());
+    {
+        ThreadPool Pool(hardware_concurrency(Threads));
+        for (unsigned I = 0, E = Objects.size(); I != E; ++I)
+            Pool.async([&, I] {
+                Results[I] = analyseObject(F, Objects[I], Visible[I],
+                                           Accesses);
+            });
+        Pool.wait();
+    }
+
+    printMemoryLivenessResult(errs(), F, Results);
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
@@ -0,0 +1,143 @@
+//=============================================================================
+// DESCRIPTION:
+//    Predicts how many copies SSA destruction (phi elimination) will insert.
+//    Phi results and their operands are grouped into phi webs; a copy is
+//    needed wherever a web member cannot share a register with the rest of
+//    its web because the two interfere.
+//
+//    Interference is checked with InterferenceQuery, pairwise against the
+//    values coalesced so far, without building an interference graph.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Union every phi with its operands into phi webs
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    For every web, visit its phis in layout order and greedily coalesce the
+//    phi result and each operand into the web's register unless it
+//    interferes with a value already coalesced. Every value that is left out
+//    and every constant operand costs one copy, placed in the incoming
+//    block (operands) or the phi block (results).
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Weight every copy by the frequency of the block it is placed in and
+//    report the webs responsible for copies
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+struct PhiWeb {
+    SmallVector<PHINode *, 4> Phis;
+    unsigned Copies = 0;
+    double Weighted = 0.0;
+};
+} // namespace
+
+PreservedAnalyses PhiCopiesPass::run(Function &F,
+                                     FunctionAnalysisManager &FAM) {
+    auto &LS = FAM.getResult<LiveSetsAnalysis>(F);
+    InterferenceQuery IQ(LS, FAM.getResult<DominatorTreeAnalysis>(F));
+    auto &BFI = FAM.getResult<BlockFrequencyAnalysis>(F);
+    double EntryFreq = static_cast<double>(BFI.getEntryFreq());
+    auto Freq = [&](const BasicBlock *BB) {
+        return static_cast<double>(BFI.getBlockFreq(BB).getFrequency()) /
+               EntryFreq;
+    };
+
+    // STEP 1: Phi webs
+    EquivalenceClasses<const Value *> Webs;
+    SmallVector<PHINode *, 16> Phis;
+    unsigned Naive = 0;
+    for (BasicBlock &BB : F)
+        for (PHINode &Phi : BB.phis()) {
+            Phis.push_back(&Phi);
+            Webs.insert(&Phi);
+            Naive += 1 + Phi.getNumIncomingValues();
+            for (Value *Op : Phi.incoming_values())
+                if (LS.isTracked(Op))
+                    Webs.unionSets(&Phi, Op);
+        }
+
+    // STEP 2: Greedy coalescing, one web at a time
+    MapVector<const Value *, PhiWeb> WebInfo;
+    DenseMap<const Value *, SmallVector<const Value *, 8>> Coalesced;
+    for (PHINode *Phi : Phis) {
+        const Value *Leader = Webs.getLeaderValue(Phi);
+        PhiWeb &Web = WebInfo[Leader];
+        auto &Members = Coalesced[Leader];
+        Web.Phis.push_back(Phi);
+
+        auto TryCoalesce = [&](const Value *V) {
+            if (is_contained(Members, V))
+                return true;
+            if (IQ.findInterference(V, Members))
+                return false;
+            Members.push_back(V);
+            return true;
+        };
+
+        if (!TryCoalesce(Phi)) {
+            ++Web.Copies;
+            Web.Weighted += Freq(Phi->getParent());
+        }
+        for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+            Value *Op = Phi->getIncomingValue(I);
+            if (isa<UndefValue>(Op))
+                continue;
+            if (!LS.isTracked(Op) || !TryCoalesce(Op)) {
+                ++Web.Copies;
+                Web.Weighted += Freq(Phi->getIncomingBlock(I));
+            }
+        }
+    }
+
+    // STEP 3: Report
+    unsigned Copies = 0;
+    double Weighted = 0.0;
+    for (auto const &KV : WebInfo) {
+        Copies += KV.second.Copies;
+        Weighted += KV.second.Weighted;
+    }
+
+    raw_ostream &OutS = errs();
+    OutS << "=================================================\n";
+    OutS << "Out-of-SSA copy estimate for function " << F.getName() << "\n";
+    OutS << "=================================================\n";
+    OutS << format("phis %u, webs %u, copies %u (naive %u), weighted %.2f\n",
+                   static_cast<unsigned>(Phis.size()),
+                   static_cast<unsigned>(WebInfo.size()), Copies, Naive,
+                   Weighted);
+    for (auto const &KV : WebInfo) {
+        const PhiWeb &Web = KV.second;
+        if (!Web.Copies)
+            continue;
+        std::string DummyStr;
+        raw_string_ostream WebStr(DummyStr);
+        Web.Phis.front()->printAsOperand(WebStr, false);
+        OutS << format("[[Web %s]] copies %u, weighted %.2f\n",
+                       WebStr.str().c_str(), Web.Copies, Web.Weighted);
+        for (const PHINode *Phi : Web.Phis) {
+            std::string DummyStr;
+            raw_string_ostream InstrStr(DummyStr);
+            Phi->print(InstrStr);
+            OutS << format("==>%s\n", InstrStr.str().c_str());
+        }
+    }
+    OutS << "-------------------------------------------------\n\n";
+
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
@@ -0,0 +1,191 @@
+//=============================================================================
+// DESCRIPTION:
+//    Pressure hints: the maximum and average register pressure of a function,
+//    stored as the string attributes "liveness-max-pressure" and
+//    "liveness-avg-pressure". They are cheap enough to compute for every
+//    function a JIT materialises (see LivenessJIT.h), and a later tier can
+//    read them back with getPressureHints to pick its optimisation level.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Compute the block live-outs (LiveSets, flat engine)
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    Walk every block backwards from its live-out set, keeping the pressure
+//    as a running count: a definition that is live lowers it, an operand
+//    that was not live raises it (register values only). This avoids
+//    counting a whole set at every program point.
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Attach the maximum and the average to the function
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+constexpr const char *MaxPressureAttr = "liveness-max-pressure";
+constexpr const char *AvgPressureAttr = "liveness-avg-pressure";
+
+// The same hints from LiveSets::getPressure at every program point, used as
+// the reference by the benchmark
+PressureHints computePressureHintsNaive(const LiveSets &LS) {
+    PressureHints Hints;
+    uint64_t Sum = 0, Points = 0;
+    for (const BasicBlock &BB : LS.getFunction()) {
+        Hints.MaxPressure =
+                std::max(Hints.MaxPressure, LS.getMaxPressure(&BB));
+        LS.walkBlockBackward(BB, [&](const Instruction &,
+                                     const BitVector &Live) {
+            Sum += LS.getPressure(Live);
+            ++Points;
+        });
+    }
+    Hints.AvgPressure = Points ? double(Sum) / Points : 0.0;
+    return Hints;
+}
+
+bool isSameHints(const PressureHints &A, const PressureHints &B) {
+    return A.MaxPressure == B.MaxPressure &&
+           std::abs(A.AvgPressure - B.AvgPressure) < 1e-9;
+}
+} // namespace
+
+// STEP 2: Running pressure count, block by block
+PressureHints computePressureHints(const LiveSets &LS) {
+    const BitVector &RegMask = LS.getRegisterMask();
+    PressureHints Hints;
+    uint64_t Sum = 0, Points = 0;
+    BitVector Live;
+    for (const BasicBlock &BB : LS.getFunction()) {
+        Live = LS.getLiveOut(&BB);
+        unsigned Pressure = LS.getPressure(Live);
+        for (const Instruction &Inst : reverse(BB)) {
+            Hints.MaxPressure = std::max(Hints.MaxPressure, Pressure);
+            Sum += Pressure;
+            ++Points;
+            int Idx = LS.getIndex(&Inst);
+            if (Idx >= 0 && Live.test(Idx)) {
+                Live.reset(Idx);
+                Pressure -= RegMask.test(Idx);
+            }
+            if (isa<PHINode>(Inst))
+                continue;
+            for (const Value *Op : Inst.operands()) {
+                int OpIdx = LS.getIndex(Op);
+                if (OpIdx >= 0 && !Live.test(OpIdx)) {
+                    Live.set(OpIdx);
+                    Pressure += RegMask.test(OpIdx);
+                }
+            }
+        }
+        // What is left is the live-in set
+        Hints.MaxPressure = std::max(Hints.MaxPressure, Pressure);
+    }
+    Hints.AvgPressure = Points ? double(Sum) / Points : 0.0;
+    return Hints;
+}
+
+// STEP 3: Store and load the hints
+void setPressureHints(Function &F, const PressureHints &Hints) {
+    F.addFnAttr(MaxPressureAttr, utostr(Hints.MaxPressure));
+    std::string DummyStr;
+    raw_string_ostream AvgStr(DummyStr);
+    AvgStr << format("%.2f", Hints.AvgPressure);
+    F.addFnAttr(AvgPressureAttr, AvgStr.str());
+}
+
+Optional<PressureHints> getPressureHints(const Function &F) {
+    if (!F.hasFnAttribute(MaxPressureAttr) ||
+        !F.hasFnAttribute(AvgPressureAttr))
+        return None;
+    PressureHints Hints;
+    if (F.getFnAttribute(MaxPressureAttr)
+                .getValueAsString()
+                .getAsInteger(10, Hints.MaxPressure) ||
+        F.getFnAttribute(AvgPressureAttr)
+                .getValueAsString()
+                .getAsDouble(Hints.AvgPressure))
+        return None;
+    return Hints;
+}
+
+unsigned annotatePressureHints(Module &M) {
+    unsigned Count = 0;
+    for (Function &F : M) {
+        // Functions materialised again (e.g. by a higher tier) keep the
+        // hints they already have
+        if (F.isDeclaration() || getPressureHints(F))
+            continue;
+        // STEP 1: Live-outs
+        LiveSets LS(F);
+        setPressureHints(F, computePressureHints(LS));
+        ++Count;
+    }
+    return Count;
+}
+
+//-----------------------------------------------------------------------------
+// pressure-hints, pressure-hints-bench
+//-----------------------------------------------------------------------------
+PreservedAnalyses PressureHintsPass::run(Module &M, ModuleAnalysisManager &) {
+    annotatePressureHints(M);
+    // Only function attributes change
+    return PreservedAnalyses::all();
+}
+
+PreservedAnalyses PressureHintsBenchPass::run(Module &M,
+                                              ModuleAnalysisManager &) {
+    TimeRecord LivenessTime, HintsTime, NaiveTime;
+    unsigned Functions = 0, Blocks = 0, Instructions = 0;
+    bool Same = true;
+    for (Function &F : M) {
+        if (F.isDeclaration())
+            continue;
+        ++Functions;
+        Blocks += F.size();
+        Instructions += F.getInstructionCount();
+        for (unsigned I = 0; I < Repeat; ++I) {
+            LivenessTime -= TimeRecord::getCurrentTime(true);
+            LiveSets LS(F);
+            LivenessTime += TimeRecord::getCurrentTime(false);
+
+            HintsTime -= TimeRecord::getCurrentTime(true);
+            PressureHints Hints = computePressureHints(LS);
+            HintsTime += TimeRecord::getCurrentTime(false);
+
+            NaiveTime -= TimeRecord::getCurrentTime(true);
+            PressureHints Naive = computePressureHintsNaive(LS);
+            NaiveTime += TimeRecord::getCurrentTime(false);
+
+            Same &= isSameHints(Hints, Naive);
+        }
+    }
+
+    double Total = (LivenessTime.getWallTime() + HintsTime.getWallTime()) /
+                   std::max(Repeat, 1u);
+    errs() << format("pressure-hints-bench: %u functions, %u blocks, %u "
+                     "instructions, %s (%u runs)\n",
+                     Functions, Blocks, Instructions,
+                     Same ? "results match" : "RESULTS DIFFER", Repeat);
+    errs() << format("  liveness %.3f ms, hints %.3f ms, naive hints %.3f "
+                     "ms\n",
+                     LivenessTime.getWallTime() * 1000.0,
+                     HintsTime.getWallTime() * 1000.0,
+                     NaiveTime.getWallTime() * 1000.0);
+    errs() << format("  per function %.1f us, per instruction %.1f ns\n",
+                     Functions ? Total / Functions * 1e6 : 0.0,
+                     Instructions ? Total / Instructions * 1e9 : 0.0);
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
@@ -0,0 +1,263 @@
+//=============================================================================
+// DESCRIPTION:
+//    Reorders the instructions of every block to lower its peak register
+//    pressure, using the block live-outs from LiveSets and the data and
+//    ordering dependences inside the block. A block is only rewritten if its
+//    peak goes down.
+//
+//    Moving instructions inside a block (after their operands, before their
+//    users) changes neither the upward-exposed uses nor the definitions of
+//    the block, so every live-in and live-out set stays the same and the
+//    cached LiveSets are preserved as they are. Only the ordinals stop
+//    following the layout order, which nothing relies on.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    Live  = values live below the next instruction to schedule
+//    Delta = (operands of I not in Live) - (1 if I's result is in Live)
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    The schedulable region of BB is everything between the phis/EH pad and
+//    the terminator, except debug and pseudo-probe intrinsics: those are
+//    pinned to the instruction before them and moved along with it. Barriers (instructions that write memory, have side
+//    effects or may not return) keep their relative order, and loads and
+//    instructions that may trap stay between the same two barriers;
+//    everything else only depends on its operands.
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    Schedule bottom-up starting from Live = LiveOut_BB (after the
+//    terminator): among the instructions whose users in the region are all
+//    scheduled, pick the one with the smallest Delta (the latest in the
+//    original order on ties). Track the peak of |Live| over register values.
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    If the new peak is lower than the old one, move the instructions into
+//    the new order and put the pinned intrinsics back behind their
+//    instructions
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+// Larger blocks are left alone, the greedy choice is quadratic
+constexpr unsigned MaxRegionSize = 1024;
+
+// Writes memory, has side effects or may not reach the next instruction
+bool isBarrier(const Instruction &I) {
+    return I.mayWriteToMemory() || I.mayHaveSideEffects() ||
+           !isGuaranteedToTransferExecutionToSuccessor(&I);
+}
+
+// Reads memory or may trap, so it must stay between the same barriers
+bool isPinned(const Instruction &I) {
+    return I.mayReadFromMemory() || !isSafeToSpeculativelyExecute(&I);
+}
+
+bool isMustTailCall(const Instruction &I) {
+    auto *CI = dyn_cast<CallInst>(&I);
+    return CI && CI->isMustTailCall();
+}
+
+struct Schedule {
+    // Bottom-up, i.e. the new order reversed
+    std::vector<Instruction *> Order;
+    unsigned Peak = 0;
+};
+
+// STEP 1 + 2: Greedy bottom-up schedule of Region, the instructions of BB
+// before the terminator
+Schedule schedule(const LiveSets &LS, const BasicBlock &BB,
+                  ArrayRef<Instruction *> Region) {
+    const BitVector &RegMask = LS.getRegisterMask();
+    DenseMap<const Instruction *, unsigned> Pos;
+    for (unsigned I = 0, E = Region.size(); I != E; ++I)
+        Pos[Region[I]] = I;
+
+    // Number of unscheduled successors (users and ordering dependences) of
+    // every instruction
+    std::vector<unsigned> Pending(Region.size(), 0);
+    std::vector<SmallVector<unsigned, 4>> Preds(Region.size());
+    auto AddDep = [&](unsigned I, unsigned Pred) {
+        Preds[I].push_back(Pred);
+        ++Pending[Pred];
+    };
+    int LastBarrier = -1;
+    SmallVector<unsigned, 8> PinnedSinceBarrier;
+    for (unsigned I = 0, E = Region.size(); I != E; ++I) {
+        SmallPtrSet<const Instruction *, 4> Seen;
+        for (const Value *Op : Region[I]->operands()) {
+            auto *OpInst = dyn_cast<Instruction>(Op);
+            auto It = OpInst ? Pos.find(OpInst) : Pos.end();
+            if (It != Pos.end() && Seen.insert(OpInst).second)
+                AddDep(I, It->second);
+        }
+        if (isBarrier(*Region[I])) {
+            if (LastBarrier >= 0)
+                AddDep(I, LastBarrier);
+            for (unsigned P : PinnedSinceBarrier)
+                AddDep(I, P);
+            PinnedSinceBarrier.clear();
+            LastBarrier = I;
+        } else if (isPinned(*Region[I])) {
+            if (LastBarrier >= 0)
+                AddDep(I, LastBarrier);
+            PinnedSinceBarrier.push_back(I);
+        }
+    }
+
+    // Values live above the terminator
+    const Instruction *Term = BB.getTerminator();
+    BitVector Live = LS.getLiveOut(&BB);
+    unsigned Pressure = LS.getPressure(Live);
+    Schedule Result;
+    Result.Peak = Pressure;
+    auto Kill = [&](const Instruction *I) {
+        int Idx = LS.getIndex(I);
+        if (Idx >= 0 && Live.test(Idx)) {
+            Live.reset(Idx);
+            Pressure -= RegMask.test(Idx);
+        }
+    };
+    auto UseOperands = [&](const Instruction *I) {
+        for (const Value *Op : I->operands()) {
+            int Idx = LS.getIndex(Op);
+            if (Idx >= 0 && !Live.test(Idx)) {
+                Live.set(Idx);
+                Pressure += RegMask.test(Idx);
+            }
+        }
+    };
+    Kill(Term);
+    UseOperands(Term);
+
+    auto Delta = [&](const Instruction *I) {
+        int D = 0;
+        SmallPtrSet<const Value *, 4> Seen;
+        for (const Value *Op : I->operands()) {
+            int Idx = LS.getIndex(Op);
+            if (Idx >= 0 && RegMask.test(Idx) && !Live.test(Idx) &&
+                Seen.insert(Op).second)
+                ++D;
+        }
+        int Idx = LS.getIndex(I);
+        if (Idx >= 0 && RegMask.test(Idx) && Live.test(Idx))
+            --D;
+        return D;
+    };
+
+    std::vector<unsigned> Ready;
+    for (unsigned I = 0, E = Region.size(); I != E; ++I)
+        if (!Pending[I])
+            Ready.push_back(I);
+    while (!Ready.empty()) {
+        auto Best = Ready.begin();
+        int BestDelta = Delta(Region[*Best]);
+        for (auto It = std::next(Ready.begin()); It != Ready.end(); ++It) {
+            int D = Delta(Region[*It]);
+            if (D < BestDelta || (D == BestDelta && *It > *Best)) {
+                Best = It;
+                BestDelta = D;
+            }
+        }
+        unsigned I = *Best;
+        Ready.erase(Best);
+
+        // Pressure right after Region[I]
+        Result.Peak = std::max(Result.Peak, Pressure);
+        Result.Order.push_back(Region[I]);
+        Kill(Region[I]);
+        UseOperands(Region[I]);
+        for (unsigned P : Preds[I])
+            if (!--Pending[P])
+                Ready.push_back(P);
+    }
+    // What is left is the live-in set
+    Result.Peak = std::max(Result.Peak, Pressure);
+    return Result;
+}
+} // namespace
+
+PreservedAnalyses PressureSchedPass::run(Function &F,
+                                         FunctionAnalysisManager &FAM) {
+    const LiveSets &LS = FAM.getResult<LiveSetsAnalysis>(F);
+
+    raw_ostream &OutS = errs();
+    OutS << "=================================================\n";
+    OutS << "Pressure scheduling for function " << F.getName() << "\n";
+    OutS << "=================================================\n";
+
+    unsigned Changed = 0, PeakBefore = 0, PeakAfter = 0;
+    for (BasicBlock &BB : F) {
+        unsigned Before = LS.getMaxPressure(&BB);
+        PeakBefore = std::max(PeakBefore, Before);
+
+        // STEP 1: The region. Debug intrinsics before the first region
+        // instruction stay at the top of the block.
+        SmallVector<Instruction *, 32> Region;
+        SmallVector<std::pair<Instruction *, Instruction *>, 8> Pinned;
+        bool MustTail = false;
+        for (auto It = BB.getFirstInsertionPt(), E = BB.end(); It != E; ++It) {
+            if (It->isTerminator())
+                continue;
+            if (It->isDebugOrPseudoInst()) {
+                if (!Region.empty())
+                    Pinned.emplace_back(&*It, Region.back());
+                continue;
+            }
+            Region.push_back(&*It);
+            MustTail |= isMustTailCall(*It);
+        }
+        if (Region.size() < 2 || Region.size() > MaxRegionSize || MustTail) {
+            PeakAfter = std::max(PeakAfter, Before);
+            continue;
+        }
+
+        // STEP 2: Schedule
+        Schedule S = schedule(LS, BB, Region);
+        if (S.Peak >= Before) {
+            PeakAfter = std::max(PeakAfter, Before);
+            continue;
+        }
+
+        // STEP 3: Rewrite the block
+        Instruction *Term = BB.getTerminator();
+        for (Instruction *I : reverse(S.Order))
+            I->moveBefore(Term);
+        // Backwards, so intrinsics pinned to the same instruction keep their
+        // order
+        for (auto &P : reverse(Pinned))
+            P.first->moveAfter(P.second);
+        ++Changed;
+        PeakAfter = std::max(PeakAfter, S.Peak);
+
+        std::string DummyStr;
+        raw_string_ostream BBIdStream(DummyStr);
+        BB.printAsOperand(BBIdStream, false);
+        OutS << format("[[BasicBlock %s]] peak %u -> %u\n",
+                       BBIdStream.str().c_str(), Before, S.Peak);
+    }
+    OutS << format("rescheduled %u of %u blocks, peak pressure %u -> %u\n",
+                   Changed, static_cast<unsigned>(F.size()), PeakBefore,
+                   PeakAfter);
+    if (Verify)
+        OutS << (LS.isEquivalentTo(LiveSets(F)) ? "live sets verified\n"
+                                                 : "LIVE SETS DIFFER\n");
+    OutS << "-------------------------------------------------\n\n";
+
+    if (!Changed)
+        return PreservedAnalyses::all();
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    PA.preserve<LiveSetsAnalysis>();
+    return PA;
+}
+
+} // namespace liveness
@@ -0,0 +1,334 @@
+//=============================================================================
+// DESCRIPTION:
+//    Promotes allocas to SSA values, placing phis only where the variable
+//    is live (pruned SSA). The live-in blocks of every alloca come from the
+//    same backward walk LiveSets uses for SSA values (computeLiveInBlocks);
+//    the dominance frontiers are computed once per function and shared by
+//    all allocas. 'promote-bench' compares the result and the run time with
+//    LLVM's PromoteMemToReg (mem2reg) on clones of the same functions.
+//
+//    An alloca is promoted if every use is a simple (non-volatile) load or
+//    store of the allocated type through the alloca itself. Its dbg.declares
+//    are turned into dbg.values at the stores and phis, as mem2reg does.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    Defs_a   = blocks storing to alloca a
+//    Uses_a   = blocks loading a before any store to it in the block
+//    LiveIn_a = blocks on a path from Uses_a back to Defs_a
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Compute the dominance frontier DF of every block (Cooper, Harvey and
+//    Kennedy: walk up the dominator tree from each predecessor of a join)
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    For every alloca a, iterate DF from Defs_a, inserting a phi in a block
+//    of DF only if it is in LiveIn_a; a new phi is a new definition
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Rename along the CFG from the entry block, carrying the current value
+//    of every alloca: loads are replaced by it, stores update it, phis
+//    receive it on each incoming edge. Loads in unreachable blocks read
+//    undef.
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/DIBuilder.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/PromoteMemToReg.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+bool isPromotable(const AllocaInst *AI) {
+    Type *Ty = AI->getAllocatedType();
+    for (const User *U : AI->users()) {
+        if (auto *LI = dyn_cast<LoadInst>(U)) {
+            if (LI->isVolatile() || LI->getType() != Ty)
+                return false;
+        } else if (auto *SI = dyn_cast<StoreInst>(U)) {
+            if (SI->isVolatile() || SI->getValueOperand() == AI ||
+                SI->getValueOperand()->getType() != Ty)
+                return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<AllocaInst *> getPromotableAllocas(Function &F) {
+    std::vector<AllocaInst *> Allocas;
+    for (Instruction &I : F.getEntryBlock())
+        if (auto *AI = dyn_cast<AllocaInst>(&I))
+            if (isPromotable(AI))
+                Allocas.push_back(AI);
+    return Allocas;
+}
+
+unsigned countPhis(const Function &F) {
+    unsigned Count = 0;
+    for (const BasicBlock &BB : F)
+        Count += std::distance(BB.phis().begin(), BB.phis().end());
+    return Count;
+}
+
+// STEP 1: Dominance frontiers of the reachable blocks
+using FrontierMap = DenseMap<const BasicBlock *, SmallVector<BasicBlock *, 4>>;
+FrontierMap computeFrontiers(Function &F, DominatorTree &DT) {
+    FrontierMap DF;
+    for (BasicBlock &BB : F) {
+        DomTreeNode *Node = DT.getNode(&BB);
+        if (!Node || !Node->getIDom() || BB.hasNPredecessors(1))
+            continue;
+        const DomTreeNode *IDom = Node->getIDom();
+        for (BasicBlock *Pred : predecessors(&BB)) {
+            for (DomTreeNode *Runner = DT.getNode(Pred);
+                 Runner && Runner != IDom; Runner = Runner->getIDom()) {
+                auto &Frontier = DF[Runner->getBlock()];
+                // All entries for BB are added in a row
+                if (!Frontier.empty() && Frontier.back() == &BB)
+                    break;
+                Frontier.push_back(&BB);
+            }
+        }
+    }
+    return DF;
+}
+} // namespace
+
+unsigned promoteAllocas(ArrayRef<AllocaInst *> Allocas, DominatorTree &DT) {
+    if (Allocas.empty())
+        return 0;
+    Function &F = *Allocas.front()->getFunction();
+    FrontierMap DF = computeFrontiers(F, DT);
+
+    DenseMap<const AllocaInst *, unsigned> AllocaIdx;
+    for (unsigned I = 0, E = Allocas.size(); I != E; ++I)
+        AllocaIdx[Allocas[I]] = I;
+
+    // dbg.declares become dbg.values at every store and phi, as in mem2reg
+    DIBuilder DIB(*F.getParent(), /*AllowUnresolved=*/false);
+    std::vector<TinyPtrVector<DbgVariableIntrinsic *>> DbgDeclares;
+    for (AllocaInst *AI : Allocas)
+        DbgDeclares.push_back(FindDbgAddrUses(AI));
+
+    // STEP 2: Pruned phi placement
+    DenseMap<PHINode *, unsigned> PhiToAlloca;
+    for (unsigned A = 0, E = Allocas.size(); A != E; ++A) {
+        AllocaInst *AI = Allocas[A];
+        SmallPtrSet<const BasicBlock *, 8> DefBlocks;
+        for (User *U : AI->users())
+            if (auto *SI = dyn_cast<StoreInst>(U))
+                DefBlocks.insert(SI->getParent());
+        SmallVector<const BasicBlock *, 8> UseBlocks;
+        SmallPtrSet<const BasicBlock *, 8> Seen;
+        for (User *U : AI->users()) {
+            auto *LI = dyn_cast<LoadInst>(U);
+            if (!LI || !Seen.insert(LI->getParent()).second)
+                continue;
+            if (!DefBlocks.count(LI->getParent())) {
+                UseBlocks.push_back(LI->getParent());
+                continue;
+            }
+            // Is the first access in the block (in program order, not in
+            // use-list order) a load?
+            for (const Instruction &I : *LI->getParent()) {
+                if (auto *SI = dyn_cast<StoreInst>(&I))
+                    if (SI->getPointerOperand() == AI)
+                        break;
+                if (auto *Load = dyn_cast<LoadInst>(&I))
+                    if (Load->getPointerOperand() == AI) {
+                        UseBlocks.push_back(LI->getParent());
+                        break;
+                    }
+            }
+        }
+        SmallPtrSet<const BasicBlock *, 32> LiveIn;
+        computeLiveInBlocks(UseBlocks, DefBlocks, LiveIn);
+
+        SmallVector<const BasicBlock *, 16> Worklist(DefBlocks.begin(),
+                                                     DefBlocks.end());
+        SmallPtrSet<const BasicBlock *, 16> HasPhi;
+        while (!Worklist.empty()) {
+            const BasicBlock *BB = Worklist.pop_back_val();
+            auto It = DF.find(BB);
+            if (It == DF.end())
+                continue;
+            for (BasicBlock *Join : It->second) {
+                if (!LiveIn.count(Join) || !HasPhi.insert(Join).second)
+                    continue;
+                PHINode *Phi = PHINode::Create(
+                        AI->getAllocatedType(), pred_size(Join),
+                        AI->getName(), &Join->front());
+                PhiToAlloca[Phi] = A;
+                for (DbgVariableIntrinsic *DII : DbgDeclares[A])
+                    ConvertDebugDeclareToDebugValue(DII, Phi, DIB);
+                if (!DefBlocks.count(Join))
+                    Worklist.push_back(Join);
+            }
+        }
+    }
+
+    // STEP 3: Renaming
+    struct RenameItem {
+        BasicBlock *BB;
+        BasicBlock *Pred;
+        std::vector<Value *> Values;
+    };
+    std::vector<Value *> Initial;
+    for (AllocaInst *AI : Allocas)
+        Initial.push_back(UndefValue::get(AI->getAllocatedType()));
+    std::vector<RenameItem> Worklist;
+    Worklist.push_back({&F.getEntryBlock(), nullptr, std::move(Initial)});
+    SmallPtrSet<BasicBlock *, 32> Visited;
+    while (!Worklist.empty()) {
+        RenameItem Item = std::move(Worklist.back());
+        Worklist.pop_back();
+        for (PHINode &Phi : Item.BB->phis()) {
+            auto It = PhiToAlloca.find(&Phi);
+            if (It == PhiToAlloca.end())
+                continue;
+            Phi.addIncoming(Item.Values[It->second], Item.Pred);
+            Item.Values[It->second] = &Phi;
+        }
+        if (!Visited.insert(Item.BB).second)
+            continue;
+
+        for (auto It = Item.BB->begin(); It != Item.BB->end();) {
+            Instruction &I = *It++;
+            if (auto *LI = dyn_cast<LoadInst>(&I)) {
+                auto A = AllocaIdx.find(
+                        dyn_cast<AllocaInst>(LI->getPointerOperand()));
+                if (A == AllocaIdx.end())
+                    continue;
+                LI->replaceAllUsesWith(Item.Values[A->second]);
+                LI->eraseFromParent();
+            } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+                auto A = AllocaIdx.find(
+                        dyn_cast<AllocaInst>(SI->getPointerOperand()));
+                if (A == AllocaIdx.end())
+                    continue;
+                Item.Values[A->second] = SI->getValueOperand();
+                for (DbgVariableIntrinsic *DII : DbgDeclares[A->second])
+                    ConvertDebugDeclareToDebugValue(DII, SI, DIB);
+                SI->eraseFromParent();
+            }
+        }
+        // One item per edge, a phi needs an entry for each
+        for (BasicBlock *Succ : successors(Item.BB))
+            Worklist.push_back({Succ, Item.BB, Item.Values});
+    }
+
+    for (auto &DIIs : DbgDeclares)
+        for (DbgVariableIntrinsic *DII : DIIs)
+            DII->eraseFromParent();
+
+    // Unreachable code
+    for (AllocaInst *AI : Allocas) {
+        while (!AI->use_empty()) {
+            auto *I = cast<Instruction>(AI->user_back());
+            if (!I->getType()->isVoidTy())
+                I->replaceAllUsesWith(UndefValue::get(I->getType()));
+            I->eraseFromParent();
+        }
+        AI->eraseFromParent();
+    }
+    for (auto &KV : PhiToAlloca)
+        for (BasicBlock *Pred : predecessors(KV.first->getParent()))
+            if (KV.first->getBasicBlockIndex(Pred) < 0)
+                KV.first->addIncoming(UndefValue::get(KV.first->getType()),
+                                      Pred);
+    return PhiToAlloca.size();
+}
+
+//-----------------------------------------------------------------------------
+// promote-allocas, promote-bench
+//-----------------------------------------------------------------------------
+PreservedAnalyses PromoteAllocasPass::run(Function &F,
+                                          FunctionAnalysisManager &FAM) {
+    auto &DT = FAM.getResult<DominatorTreeAnalysis>(F);
+    std::vector<AllocaInst *> Allocas = getPromotableAllocas(F);
+    unsigned Phis = promoteAllocas(Allocas, DT);
+
+    raw_ostream &OutS = errs();
+    OutS << "=================================================\n";
+    OutS << "Alloca promotion for function " << F.getName() << "\n";
+    OutS << "=================================================\n";
+    OutS << format("promoted %u allocas, inserted %u phis\n",
+                   static_cast<unsigned>(Allocas.size()), Phis);
+    OutS << "-------------------------------------------------\n\n";
+
+    if (Allocas.empty())
+        return PreservedAnalyses::all();
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+}
+
+PreservedAnalyses PromoteBenchPass::run(Module &M, ModuleAnalysisManager &) {
+    std::vector<Function *> Funcs;
+    for (Function &F : M)
+        if (!F.isDeclaration())
+            Funcs.push_back(&F);
+
+    TimeRecord OursTime, Mem2RegTime;
+    unsigned Functions = 0, Allocas = 0, OursPhis = 0, Mem2RegPhis = 0;
+    for (Function *F : Funcs) {
+        unsigned N = getPromotableAllocas(*F).size();
+        if (!N)
+            continue;
+        ++Functions;
+        Allocas += N;
+        for (unsigned I = 0; I < Repeat; ++I) {
+            // Each engine promotes its own clone, dominator trees are built
+            // outside the timed region
+            ValueToValueMapTy OursMap, Mem2RegMap;
+            Function *Ours = CloneFunction(F, OursMap);
+            Function *Mem2Reg = CloneFunction(F, Mem2RegMap);
+            DominatorTree OursDT(*Ours), Mem2RegDT(*Mem2Reg);
+            std::vector<AllocaInst *> OursAllocas =
+                    getPromotableAllocas(*Ours);
+            std::vector<AllocaInst *> Mem2RegAllocas =
+                    getPromotableAllocas(*Mem2Reg);
+            unsigned PhisBefore = countPhis(*Mem2Reg);
+
+            OursTime -= TimeRecord::getCurrentTime(true);
+            promoteAllocas(OursAllocas, OursDT);
+            OursTime += TimeRecord::getCurrentTime(false);
+
+            Mem2RegTime -= TimeRecord::getCurrentTime(true);
+            PromoteMemToReg(Mem2RegAllocas, Mem2RegDT);
+            Mem2RegTime += TimeRecord::getCurrentTime(false);
+
+            if (I == 0) {
+                OursPhis += countPhis(*Ours) - PhisBefore;
+                Mem2RegPhis += countPhis(*Mem2Reg) - PhisBefore;
+            }
+            Ours->eraseFromParent();
+            Mem2Reg->eraseFromParent();
+        }
+    }
+
+    errs() << format("promote-bench: %u functions, %u allocas (%u runs)\n",
+                     Functions, Allocas, Repeat);
+    errs() << format("  live-in placement %.3f ms, %u phis\n",
+                     OursTime.getWallTime() * 1000.0, OursPhis);
+    errs() << format("  PromoteMemToReg   %.3f ms, %u phis\n",
+                     Mem2RegTime.getWallTime() * 1000.0, Mem2RegPhis);
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
@@ -0,0 +1,387 @@
+//=============================================================================
+// DESCRIPTION:
+//    Random IR generator and differential checker. 'riv-fuzz' generates
+//    random well-formed functions into a scratch module (the input module is
+//    not used) and, for every function, compares
+//      - buildRIV against buildRIVReference, and
+//      - the flat LiveSets engine against the region engine,
+//    reporting any mismatch together with the generating seed and the IR.
+//    The time spent in every implementation is reported as well, so the
+//    same run doubles as a throughput benchmark.
+//
+//    Generated functions have loops, phis, switches and (optionally)
+//    invokes with landing pads; with 'irreducible' back edges may target any
+//    block, which makes most large CFGs irreducible. With 'unreachable' a
+//    few blocks without a path from the entry branch into the function, and
+//    with 'threads' the region engine solves on a thread pool.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    CFG: block I falls through to I + 1 and may branch forward to a random
+//    later block. Back edges then go to a dominator of their source (or,
+//    with 'irreducible', anywhere but the entry). Some edges become invokes
+//    with a landing pad in between. Unreachable blocks branch to random
+//    blocks (but the entry).
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    Values: visiting the dominator tree in preorder, every block gets phis
+//    (if it has several predecessors) and random arithmetic over the values
+//    available in it, i.e. defined in the block or its dominators.
+//    Conditions of the terminators are replaced by generated compares.
+//    Unreachable blocks start from the values of a random reachable block.
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Fill in the phi operands from the values available at the end of each
+//    predecessor, verify the function and run the implementations
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/Analysis/DominanceFrontier.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/RegionInfo.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <random>
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+class FunctionGenerator {
+public:
+    FunctionGenerator(Module &M, uint64_t Seed, const FuzzOptions &Opts)
+            : M(M), Ctx(M.getContext()), Rng(Seed), Opts(Opts) {}
+
+    Function *generate(StringRef Name);
+
+private:
+    unsigned random(unsigned N) {
+        return std::uniform_int_distribution<unsigned>(0, N - 1)(Rng);
+    }
+    bool chance(unsigned Percent) { return random(100) < Percent; }
+    Value *pick(ArrayRef<Value *> Values) {
+        return Values[random(Values.size())];
+    }
+
+    void buildCFG(Function *F, std::vector<BasicBlock *> &Blocks);
+    void fillBlock(BasicBlock *BB, std::vector<Value *> &Avail);
+
+    Module &M;
+    LLVMContext &Ctx;
+    std::mt19937_64 Rng;
+    const FuzzOptions &Opts;
+};
+
+// STEP 1: Control flow
+void FunctionGenerator::buildCFG(Function *F,
+                                 std::vector<BasicBlock *> &Blocks) {
+    unsigned N = std::max(Opts.Blocks, 2u);
+    for (unsigned I = 0; I != N; ++I)
+        Blocks.push_back(BasicBlock::Create(Ctx, "bb" + Twine(I), F));
+
+    // Forward edges first, their dominator tree decides where reducible
+    // back edges may go
+    std::vector<SmallVector<BasicBlock *, 4>> Succs(N);
+    for (unsigned I = 0; I + 1 < N; ++I) {
+        Succs[I].push_back(Blocks[I + 1]);
+        if (I + 2 < N && chance(40))
+            Succs[I].push_back(Blocks[I + 2 + random(N - I - 2)]);
+    }
+    Type *Int1Ty = Type::getInt1Ty(Ctx);
+    auto SetTerminator = [&](unsigned I) {
+        BasicBlock *BB = Blocks[I];
+        if (BB->getTerminator())
+            BB->getTerminator()->eraseFromParent();
+        IRBuilder<> B(BB);
+        auto &S = Succs[I];
+        if (S.empty())
+            B.CreateRet(F->getArg(0));
+        else if (S.size() == 1)
+            B.CreateBr(S[0]);
+        else if (S.size() == 2)
+            B.CreateCondBr(UndefValue::get(Int1Ty), S[0], S[1]);
+        else {
+            SwitchInst *SI = B.CreateSwitch(F->getArg(0), S[0], S.size() - 1);
+            for (unsigned C = 1; C != S.size(); ++C)
+                SI->addCase(B.getInt32(C), S[C]);
+        }
+    };
+    for (unsigned I = 0; I != N; ++I)
+        SetTerminator(I);
+
+    // Back edges to a dominator keep the dominator tree (and the CFG
+    // reducible). The last block keeps its return.
+    DominatorTree DT(*F);
+    for (unsigned I = 1; I + 1 < N; ++I) {
+        if (!chance(Opts.Irreducible ? 35 : 25))
+            continue;
+        BasicBlock *Target = Blocks[1 + random(N - 1)];
+        if (!Opts.Irreducible) {
+            SmallVector<BasicBlock *, 8> Dominators;
+            for (DomTreeNode *Node = DT.getNode(Blocks[I]);
+                 Node->getBlock() != Blocks[0]; Node = Node->getIDom())
+                Dominators.push_back(Node->getBlock());
+            Target = Dominators[random(Dominators.size())];
+        }
+        if (!is_contained(Succs[I], Target))
+            Succs[I].push_back(Target);
+        SetTerminator(I);
+    }
+
+    // Unreachable blocks, so that reachable ones get unreachable
+    // predecessors (and unreachable ones each other)
+    if (Opts.Unreachable) {
+        unsigned NumDead = 1 + random(3);
+        for (unsigned I = 0; I != NumDead; ++I)
+            Blocks.push_back(BasicBlock::Create(Ctx, "dead" + Twine(I), F));
+        for (unsigned I = N; I != N + NumDead; ++I) {
+            IRBuilder<> B(Blocks[I]);
+            BasicBlock *Target = Blocks[1 + random(N - 1 + NumDead)];
+            BasicBlock *Other = Blocks[1 + random(N - 1)];
+            if (Other == Target || chance(50))
+                B.CreateBr(Target);
+            else
+                B.CreateCondBr(UndefValue::get(Int1Ty), Target, Other);
+        }
+    }
+
+    // Turn some two-way branches into invokes, the unwind edge going
+    // through a landing pad
+    if (!Opts.Invokes)
+        return;
+    FunctionCallee Callee = M.getOrInsertFunction(
+            "fuzz_callee", FunctionType::get(Type::getVoidTy(Ctx), false));
+    Type *LPadTy = StructType::get(Type::getInt8PtrTy(Ctx),
+                                   Type::getInt32Ty(Ctx));
+    for (unsigned I = 0; I != N; ++I) {
+        if (Succs[I].size() != 2 || !chance(30))
+            continue;
+        BasicBlock *LPad =
+                BasicBlock::Create(Ctx, "lpad" + Twine(I), F);
+        IRBuilder<> LB(LPad);
+        LB.CreateLandingPad(LPadTy, 0)->setCleanup(true);
+        LB.CreateBr(Succs[I][1]);
+        Blocks[I]->getTerminator()->eraseFromParent();
+        IRBuilder<> B(Blocks[I]);
+        B.CreateInvoke(Callee, Succs[I][0], LPad);
+        Blocks.push_back(LPad);
+    }
+}
+
+// STEP 2: Phis and arithmetic over the available values
+void FunctionGenerator::fillBlock(BasicBlock *BB,
+                                  std::vector<Value *> &Avail) {
+    Type *Int32Ty = Type::getInt32Ty(Ctx);
+    IRBuilder<> B(BB, BB->getFirstInsertionPt());
+    if (!BB->getSinglePredecessor() && !pred_empty(BB)) {
+        IRBuilder<> PB(BB, BB->begin());
+        unsigned NumPhis = 1 + random(2);
+        for (unsigned I = 0; I != NumPhis; ++I)
+            Avail.push_back(PB.CreatePHI(Int32Ty, 2));
+    }
+    unsigned NumValues = 1 + random(std::max(Opts.Values, 1u));
+    for (unsigned I = 0; I != NumValues; ++I) {
+        Value *L = pick(Avail), *R = chance(30) ? B.getInt32(random(100))
+                                                : pick(Avail);
+        static const Instruction::BinaryOps Ops[] = {
+                Instruction::Add, Instruction::Sub, Instruction::Mul,
+                Instruction::And, Instruction::Xor, Instruction::Shl};
+        Avail.push_back(B.CreateBinOp(Ops[random(6)], L, R));
+    }
+    if (auto *BI = dyn_cast<BranchInst>(BB->getTerminator()))
+        if (BI->isConditional())
+            BI->setCondition(B.CreateICmpSLT(pick(Avail), pick(Avail)));
+    if (auto *SI = dyn_cast<SwitchInst>(BB->getTerminator()))
+        SI->setCondition(pick(Avail));
+}
+
+Function *FunctionGenerator::generate(StringRef Name) {
+    Type *Int32Ty = Type::getInt32Ty(Ctx);
+    auto *FTy = FunctionType::get(Int32Ty, {Int32Ty, Int32Ty, Int32Ty}, false);
+    Function *F = Function::Create(FTy, Function::ExternalLinkage, Name, M);
+    if (Opts.Invokes)
+        F->setPersonalityFn(cast<Constant>(
+                M.getOrInsertFunction("__gxx_personality_v0",
+                                      FunctionType::get(Int32Ty, true))
+                        .getCallee()));
+
+    std::vector<BasicBlock *> Blocks;
+    buildCFG(F, Blocks);
+
+    // STEP 2: Values, in dominator tree preorder
+    DominatorTree DT(*F);
+    DenseMap<const BasicBlock *, std::vector<Value *>> AvailAtEnd;
+    std::vector<Value *> Args;
+    for (Argument &Arg : F->args())
+        Args.push_back(&Arg);
+    for (DomTreeNode *Node : depth_first(DT.getRootNode())) {
+        BasicBlock *BB = Node->getBlock();
+        std::vector<Value *> Avail =
+                Node->getIDom() ? AvailAtEnd[Node->getIDom()->getBlock()]
+                                : Args;
+        fillBlock(BB, Avail);
+        AvailAtEnd[BB] = std::move(Avail);
+    }
+    // Uses in unreachable blocks need not be dominated
+    std::vector<BasicBlock *> Reachable, Unreachable;
+    for (BasicBlock *BB : Blocks)
+        (DT.isReachableFromEntry(BB) ? Reachable : Unreachable).push_back(BB);
+    for (BasicBlock *BB : Unreachable) {
+        BasicBlock *From = Reachable[random(Reachable.size())];
+        std::vector<Value *> Avail = AvailAtEnd[From];
+        fillBlock(BB, Avail);
+        AvailAtEnd[BB] = std::move(Avail);
+    }
+
+    // STEP 3: Phi operands
+    for (BasicBlock *BB : Blocks)
+        for (PHINode &Phi : BB->phis())
+            for (BasicBlock *Pred : predecessors(BB)) {
+                if (Phi.getBasicBlockIndex(Pred) >= 0)
+                    continue;
+                auto &Avail = AvailAtEnd[Pred];
+                Phi.addIncoming(chance(20) || Avail.empty()
+                                        ? ConstantInt::get(Int32Ty, random(100))
+                                        : pick(Avail),
+                                Pred);
+            }
+
+    // Return a value that keeps some of the arithmetic alive
+    for (BasicBlock *BB : Blocks)
+        if (auto *Ret = dyn_cast<ReturnInst>(BB->getTerminator()))
+            Ret->setOperand(0, pick(AvailAtEnd[BB]));
+    return F;
+}
+
+struct FuzzStats {
+    unsigned Functions = 0, Blocks = 0, Instructions = 0, Mismatches = 0;
+    TimeRecord RIV, Reference, Flat, Region;
+};
+
+bool checkFunction(Function &F, FuzzStats &Stats, uint64_t Seed,
+                   ThreadPool *Pool) {
+    ++Stats.Functions;
+    Stats.Blocks += F.size();
+    Stats.Instructions += F.getInstructionCount();
+    if (verifyFunction(F, &errs())) {
+        errs() << format("riv-fuzz: seed %llu generated invalid IR\n",
+                         (unsigned long long)Seed);
+        ++Stats.Mismatches;
+        return false;
+    }
+
+    DominatorTree DT(F);
+    PostDominatorTree PDT(F);
+    DominanceFrontier DF;
+    DF.analyze(DT);
+    RegionInfo RI;
+    RI.recalculate(F, &DT, &PDT, &DF);
+
+    Stats.RIV -= TimeRecord::getCurrentTime(true);
+    RIVResult Optimised = buildRIV(F, DT);
+    Stats.RIV += TimeRecord::getCurrentTime(false);
+    Stats.Reference -= TimeRecord::getCurrentTime(true);
+    RIVResult Reference = buildRIVReference(F, DT);
+    Stats.Reference += TimeRecord::getCurrentTime(false);
+    Stats.Flat -= TimeRecord::getCurrentTime(true);
+    LiveSets Flat(F);
+    Stats.Flat += TimeRecord::getCurrentTime(false);
+    Stats.Region -= TimeRecord::getCurrentTime(true);
+    LiveSets Region(F, RI, Pool);
+    Stats.Region += TimeRecord::getCurrentTime(false);
+
+    const char *Failed = nullptr;
+    if (!isSameRIV(Optimised, Reference))
+        Failed = "buildRIV differs from the reference";
+    else if (!Flat.isSameAs(Region))
+        Failed = "region LiveSets differ from flat";
+    if (!Failed)
+        return true;
+    ++Stats.Mismatches;
+    errs() << format("riv-fuzz: seed %llu: %s\n", (unsigned long long)Seed,
+                     Failed);
+    F.print(errs());
+    return false;
+}
+} // namespace
+
+bool runRIVFuzz(uint64_t Seed, const FuzzOptions &Opts) {
+    LLVMContext Ctx;
+    Module M("riv-fuzz", Ctx);
+    FuzzStats Stats;
+    std::unique_ptr<ThreadPool> Pool;
+    if (Opts.Threads != 1)
+        Pool = std::make_unique<ThreadPool>(hardware_concurrency(Opts.Threads));
+    FunctionGenerator(M, Seed, Opts).generate("fuzz");
+    return checkFunction(*M.getFunction("fuzz"), Stats, Seed, Pool.get());
+}
+
+PreservedAnalyses RIVFuzzPass::run(Module &, ModuleAnalysisManager &) {
+    FuzzStats Stats;
+    // One pool for all runs, outside the timed work
+    std::unique_ptr<ThreadPool> Pool;
+    if (Opts.Threads != 1)
+        Pool = std::make_unique<ThreadPool>(hardware_concurrency(Opts.Threads));
+    for (unsigned I = 0; I != Runs; ++I) {
+        // Every function gets its own module, so the IR of a failing seed
+        // can be reproduced with runs=1
+        LLVMContext Ctx;
+        Module M("riv-fuzz", Ctx);
+        Function *F = FunctionGenerator(M, Seed + I, Opts).generate("fuzz");
+        checkFunction(*F, Stats, Seed + I, Pool.get());
+    }
+
+    auto Rate = [&](const TimeRecord &T) {
+        double Seconds = T.getWallTime();
+        return Seconds > 0 ? Stats.Blocks / Seconds / 1000.0 : 0.0;
+    };
+    errs() << format("riv-fuzz: %u functions, %u blocks, %u instructions, "
+                     "%u mismatches\n",
+                     Stats.Functions, Stats.Blocks, Stats.Instructions,
+                     Stats.Mismatches);
+    errs() << format("  buildRIV %.3f ms (%.1f kblocks/s), reference %.3f "
+                     "ms (%.1f kblocks/s)\n",
+                     Stats.RIV.getWallTime() * 1000.0, Rate(Stats.RIV),
+                     Stats.Reference.getWallTime() * 1000.0,
+                     Rate(Stats.Reference));
+    errs() << format("  flat %.3f ms (%.1f kblocks/s), region %.3f ms "
+                     "(%.1f kblocks/s)\n",
+                     Stats.Flat.getWallTime() * 1000.0, Rate(Stats.Flat),
+                     Stats.Region.getWallTime() * 1000.0, Rate(Stats.Region));
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
+
+#ifdef LIVENESS_FUZZER
+// libFuzzer entry point: the first eight bytes seed the generator, the next
+// two choose the size and the shape of the function
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *Data, size_t Size) {
+    uint64_t Seed = 0;
+    for (size_t I = 0; I != std::min<size_t>(Size, 8); ++I)
+        Seed = Seed << 8 | Data[I];
+    liveness::FuzzOptions Opts;
+    if (Size > 8)
+        Opts.Blocks = 2 + Data[8] % 64;
+    if (Size > 9) {
+        Opts.Irreducible = Data[9] & 1;
+        Opts.Invokes = Data[9] & 2;
+        Opts.Unreachable = Data[9] & 4;
+        Opts.Threads = Data[9] & 8 ? 2 : 1;
+    }
+    if (!liveness::runRIVFuzz(Seed, Opts))
+        abort();
+    return 0;
+}
+#endif
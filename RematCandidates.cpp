@@ -0,0 +1,146 @@
+//=============================================================================
+// DESCRIPTION:
+//    For every block whose register pressure exceeds a budget, lists the
+//    live-through values that could be rematerialized at their uses instead
+//    of being kept in a register, and the pressure that would remove.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    Through_N = LiveIn_N & LiveOut_N (values live across BB_N)
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    For every BB_N compute its peak pressure P_N; skip it if P_N <= budget
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    A value v in Through_N is a candidate if it is cheap to recompute and,
+//    for every use of v, all operands of v are already live at that use
+//    (so recomputing it does not extend any other live range)
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Report the candidates; the peak drops by the number of candidates that
+//    are live at the peak
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+bool isCheapToRecompute(const Instruction *I) {
+    if (I->mayHaveSideEffects() || I->mayReadFromMemory())
+        return false;
+    if (isa<GetElementPtrInst>(I) || isa<CastInst>(I) || isa<CmpInst>(I) ||
+        isa<SelectInst>(I))
+        return true;
+    if (!I->isBinaryOp())
+        return false;
+    switch (I->getOpcode()) {
+    case Instruction::UDiv:
+    case Instruction::SDiv:
+    case Instruction::URem:
+    case Instruction::SRem:
+    case Instruction::FDiv:
+    case Instruction::FRem:
+        return false;
+    default:
+        return true;
+    }
+}
+
+bool canRematerializeAt(const LiveSets &LS, const Instruction *Def,
+                        const Use &Use) {
+    if (!isCheapToRecompute(Def))
+        return false;
+
+    // Phi operands are recomputed at the end of the incoming block, other
+    // uses right before the user. An operand that dies earlier in the block
+    // is not live there.
+    const auto *User = cast<Instruction>(Use.getUser());
+    BitVector LiveAtUse;
+    if (auto *Phi = dyn_cast<PHINode>(User))
+        LiveAtUse = LS.getLiveOut(Phi->getIncomingBlock(Use));
+    else
+        LiveAtUse = LS.getLiveBefore(User);
+
+    for (const Value *Op : Def->operands()) {
+        int Idx = LS.getIndex(Op);
+        if (Idx >= 0 && needsRegister(Op) && !LiveAtUse.test(Idx))
+            return false;
+    }
+    return true;
+}
+
+PreservedAnalyses RematCandidatesPass::run(Function &F,
+                                           FunctionAnalysisManager &FAM) {
+    auto &LS = FAM.getResult<LiveSetsAnalysis>(F);
+    errs() << "=================================================\n";
+    errs() << "Rematerialization candidates for function " << F.getName()
+           << " (register budget " << Budget << ")\n";
+    errs() << "=================================================\n";
+
+    // Remat-ability of a value does not depend on the block, cache it
+    DenseMap<const Value *, bool> Cache;
+    auto IsCandidate = [&](Value *V) {
+        auto It = Cache.find(V);
+        if (It != Cache.end())
+            return It->second;
+        auto *Def = dyn_cast<Instruction>(V);
+        bool Result = Def && needsRegister(Def) && isCheapToRecompute(Def) &&
+                      all_of(Def->uses(), [&](const Use &U) {
+                          return canRematerializeAt(LS, Def, U);
+                      });
+        Cache[V] = Result;
+        return Result;
+    };
+
+    for (const BasicBlock &BB : F) {
+        // STEP 1: Find the peak
+        BitVector Peak = LS.getLiveIn(&BB);
+        unsigned PeakPressure = LS.getPressure(Peak);
+        LS.walkBlockBackward(BB,
+                             [&](const Instruction &, const BitVector &Live) {
+                                 unsigned P = LS.getPressure(Live);
+                                 if (P > PeakPressure) {
+                                     PeakPressure = P;
+                                     Peak = Live;
+                                 }
+                             });
+        if (PeakPressure <= Budget)
+            continue;
+
+        // STEP 2: Live-through candidates
+        BitVector Through = LS.getLiveIn(&BB);
+        Through &= LS.getLiveOut(&BB);
+        SmallVector<unsigned, 8> Candidates;
+        unsigned Saved = 0;
+        for (unsigned Idx : Through.set_bits())
+            if (IsCandidate(LS.getValue(Idx))) {
+                Candidates.push_back(Idx);
+                Saved += Peak.test(Idx);
+            }
+
+        // STEP 3: Report
+        std::string DummyStr;
+        raw_string_ostream BBIdStream(DummyStr);
+        BB.printAsOperand(BBIdStream, false);
+        errs() << format("[[BasicBlock %s]] pressure %u -> %u\n",
+                         BBIdStream.str().c_str(), PeakPressure,
+                         PeakPressure - Saved);
+        for (unsigned Idx : Candidates) {
+            std::string DummyStr;
+            raw_string_ostream InstrStr(DummyStr);
+            LS.getValue(Idx)->print(InstrStr);
+            errs() << format("==>%s\n", InstrStr.str().c_str());
+        }
+        errs() << "-------------------------------------------------\n";
+    }
+    errs() << "\n";
+
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
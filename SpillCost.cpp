@@ -0,0 +1,191 @@
+//=============================================================================
+// DESCRIPTION:
+//    Estimates, for every function in the module, how much spill code a
+//    register allocator with a budget of B registers would insert, and ranks
+//    the functions by that cost. Block frequencies (and the function entry
+//    count, when PGO data is present) weight every store and reload.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    Freq_N   = frequency of BB_N relative to the entry block
+//    Cost_v   = Freq(def of v) + sum of Freq(use of v)   (one store, reloads)
+//    Weight_v = Cost_v / number of blocks v is live in
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    For every value v that needs a register compute Cost_v and Weight_v
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    Visit the blocks hottest first. For every BB_N whose peak pressure P
+//    exceeds B, spill the P - B values with the lowest Weight_v among those
+//    live at the peak (values spilled for an earlier block count as free).
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    The function cost is the sum of Cost_v over the spilled values, scaled
+//    by the entry count. Rank all functions by cost.
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+struct FunctionSpillCost {
+    Function *F = nullptr;
+    double Cost = 0.0;
+    unsigned MaxPressure = 0;
+    unsigned BlocksOverBudget = 0;
+    // Spilled values and their individual cost
+    SmallVector<std::pair<Value *, double>, 8> Spills;
+};
+
+FunctionSpillCost estimateSpillCost(Function &F, const LiveSets &LS,
+                                    BlockFrequencyInfo &BFI,
+                                    unsigned Budget) {
+    FunctionSpillCost Result;
+    Result.F = &F;
+
+    double EntryFreq = static_cast<double>(BFI.getEntryFreq());
+    auto Freq = [&](const BasicBlock *BB) {
+        return static_cast<double>(BFI.getBlockFreq(BB).getFrequency()) /
+               EntryFreq;
+    };
+
+    // STEP 1: Cost and weight of every register candidate
+    unsigned NumValues = LS.getNumValues();
+    std::vector<double> Cost(NumValues, 0.0);
+    std::vector<unsigned> LiveBlocks(NumValues, 1);
+    for (unsigned Idx : LS.getRegisterMask().set_bits()) {
+        Value *V = LS.getValue(Idx);
+        auto *Def = dyn_cast<Instruction>(V);
+        Cost[Idx] = Def ? Freq(Def->getParent()) : 1.0;
+        for (const Use &U : V->uses()) {
+            auto *User = cast<Instruction>(U.getUser());
+            const BasicBlock *UseBB = User->getParent();
+            if (auto *Phi = dyn_cast<PHINode>(User))
+                UseBB = Phi->getIncomingBlock(U);
+            Cost[Idx] += Freq(UseBB);
+        }
+    }
+    for (const BasicBlock &BB : F) {
+        BitVector Live = LS.getLiveIn(&BB);
+        Live |= LS.getLiveOut(&BB);
+        for (unsigned Idx : Live.set_bits())
+            ++LiveBlocks[Idx];
+    }
+    auto Weight = [&](unsigned Idx) { return Cost[Idx] / LiveBlocks[Idx]; };
+
+    // STEP 2: Pick spill candidates at the peak of every block over budget
+    std::vector<const BasicBlock *> Order;
+    for (const BasicBlock &BB : F)
+        Order.push_back(&BB);
+    std::stable_sort(Order.begin(), Order.end(),
+                     [&](const BasicBlock *A, const BasicBlock *B) {
+                         return Freq(A) > Freq(B);
+                     });
+
+    BitVector Spilled(NumValues);
+    for (const BasicBlock *BB : Order) {
+        BitVector Peak = LS.getLiveIn(BB);
+        unsigned PeakPressure = LS.getPressure(Peak);
+        LS.walkBlockBackward(*BB,
+                             [&](const Instruction &, const BitVector &Live) {
+                                 unsigned P = LS.getPressure(Live);
+                                 if (P > PeakPressure) {
+                                     PeakPressure = P;
+                                     Peak = Live;
+                                 }
+                             });
+        Result.MaxPressure = std::max(Result.MaxPressure, PeakPressure);
+        if (PeakPressure <= Budget)
+            continue;
+        ++Result.BlocksOverBudget;
+
+        Peak &= LS.getRegisterMask();
+        BitVector AlreadySpilled = Peak;
+        AlreadySpilled &= Spilled;
+        unsigned Freed = AlreadySpilled.count();
+        if (PeakPressure - Budget <= Freed)
+            continue;
+        unsigned Excess = PeakPressure - Budget - Freed;
+
+        Peak.reset(Spilled);
+        SmallVector<unsigned, 16> Candidates;
+        for (unsigned Idx : Peak.set_bits())
+            Candidates.push_back(Idx);
+        std::stable_sort(Candidates.begin(), Candidates.end(),
+                         [&](unsigned A, unsigned B) {
+                             return Weight(A) < Weight(B);
+                         });
+        for (unsigned I = 0; I < Excess && I < Candidates.size(); ++I)
+            Spilled.set(Candidates[I]);
+    }
+
+    // STEP 3: Sum up, scaled by the profile entry count when there is one
+    double Scale = 1.0;
+    if (auto Count = F.getEntryCount())
+        Scale = static_cast<double>(Count->getCount());
+    for (unsigned Idx : Spilled.set_bits()) {
+        Result.Spills.push_back({LS.getValue(Idx), Cost[Idx] * Scale});
+        Result.Cost += Cost[Idx] * Scale;
+    }
+    return Result;
+}
+
+void printSpillCostResult(raw_ostream &OutS,
+                          std::vector<FunctionSpillCost> &Results,
+                          unsigned Budget) {
+    OutS << "=================================================\n";
+    OutS << "Spill cost estimate (register budget " << Budget << ")\n";
+    OutS << "=================================================\n";
+    OutS << "Rank  Function                              Cost  Spills  Blocks"
+            "    MaxP\n";
+
+    unsigned Rank = 0;
+    for (auto const &R : Results) {
+        OutS << format("%-6u%-30s%12.2f%8u%8u%8u\n", ++Rank,
+                       R.F->getName().str().c_str(), R.Cost,
+                       static_cast<unsigned>(R.Spills.size()),
+                       R.BlocksOverBudget, R.MaxPressure);
+        for (auto const &Spill : R.Spills) {
+            std::string DummyStr;
+            raw_string_ostream ValueStr(DummyStr);
+            Spill.first->printAsOperand(ValueStr, false);
+            OutS << format("      spill %s (cost %.2f)\n",
+                           ValueStr.str().c_str(), Spill.second);
+        }
+    }
+    OutS << "-------------------------------------------------\n";
+}
+} // namespace
+
+PreservedAnalyses SpillCostPass::run(Module &M, ModuleAnalysisManager &MAM) {
+    auto &FAM = MAM.getResult<FunctionAnalysisManagerModuleProxy>(M)
+                        .getManager();
+
+    std::vector<FunctionSpillCost> Results;
+    for (Function &F : M) {
+        if (F.isDeclaration())
+            continue;
+        auto &LS = FAM.getResult<LiveSetsAnalysis>(F);
+        auto &BFI = FAM.getResult<BlockFrequencyAnalysis>(F);
+        Results.push_back(estimateSpillCost(F, LS, BFI, Budget));
+    }
+
+    std::stable_sort(Results.begin(), Results.end(),
+                     [](const FunctionSpillCost &A,
+                        const FunctionSpillCost &B) {
+                         return A.Cost > B.Cost;
+                     });
+    printSpillCostResult(errs(), Results, Budget);
+
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
@@ -0,0 +1,233 @@
+//=============================================================================
+// DESCRIPTION:
+//    Lane-granular liveness for fixed-width vector values. For every vector
+//    value the pass computes which lanes are ever demanded by a later use,
+//    following the lanes through extractelement, insertelement, shufflevector
+//    and lane-wise operations, and reports the values whose live lanes would
+//    fit in a narrower vector, together with the vector register pressure
+//    that narrowing them would save.
+//
+//    Pressure is counted in vector registers of 'width' bits: a value of B
+//    bits occupies ceil(B / width) registers.
+//
+// ALGORITHM:
+//    -------------------------------------------------------------------------
+//    Demanded_v = lanes of v read by some use, as a bit mask
+//    -------------------------------------------------------------------------
+//    STEP 1:
+//    Solve Demanded for all vector values, starting from no lanes and
+//    iterating to a fixed point (phis make it cyclic):
+//      extractelement v, C       : lane C
+//      insertelement v, x, C     : Demanded_result minus lane C
+//      shufflevector v, w, M     : the lanes of v/w that M maps demanded
+//                                  result lanes to
+//      lane-wise ops, phis       : Demanded_result
+//      any other use             : all lanes
+//    -------------------------------------------------------------------------
+//    STEP 2:
+//    v is narrowable if the span from its lowest to its highest demanded
+//    lane needs fewer registers than v; a live value needs at least one
+//    -------------------------------------------------------------------------
+//    STEP 3:
+//    Walk every block backwards and compare the peak vector register
+//    pressure with and without narrowing
+//=============================================================================
+#include "Liveness.h"
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace liveness {
+
+namespace {
+FixedVectorType *getVectorType(const Value *V) {
+    return dyn_cast<FixedVectorType>(V->getType());
+}
+
+// Operations whose result lane i only depends on lane i of their operands
+bool isLaneWise(const Instruction *I) {
+    auto *VTy = getVectorType(I);
+    if (!VTy)
+        return false;
+    if (isa<BinaryOperator>(I) || isa<UnaryOperator>(I) || isa<CmpInst>(I) ||
+        isa<SelectInst>(I) || isa<FreezeInst>(I) || isa<PHINode>(I))
+        return true;
+    // Bitcasts may change the number of lanes
+    if (auto *Cast = dyn_cast<CastInst>(I)) {
+        auto *SrcTy = getVectorType(Cast->getOperand(0));
+        return SrcTy && SrcTy->getNumElements() == VTy->getNumElements();
+    }
+    return false;
+}
+
+// Lanes of the operand used by U that the user reads, given the lanes of
+// the user's own result that are demanded
+APInt getDemandedByUse(const Use &U, unsigned NumLanes,
+                       const DenseMap<const Value *, APInt> &Demanded) {
+    APInt All = APInt::getAllOnesValue(NumLanes);
+    auto *User = dyn_cast<Instruction>(U.getUser());
+    if (!User)
+        return All;
+    auto ResultIt = Demanded.find(User);
+    APInt None = APInt::getNullValue(NumLanes);
+
+    if (auto *EE = dyn_cast<ExtractElementInst>(User)) {
+        auto *Idx = dyn_cast<ConstantInt>(EE->getIndexOperand());
+        if (U.getOperandNo() != 0 || !Idx)
+            return All;
+        APInt Lane = None;
+        if (Idx->getZExtValue() < NumLanes)
+            Lane.setBit(Idx->getZExtValue());
+        return Lane;
+    }
+    if (ResultIt == Demanded.end())
+        return All;
+    const APInt &Result = ResultIt->second;
+
+    if (auto *IE = dyn_cast<InsertElementInst>(User)) {
+        auto *Idx = dyn_cast<ConstantInt>(IE->getOperand(2));
+        if (U.getOperandNo() != 0)
+            return All;
+        APInt Lanes = Result;
+        if (Idx && Idx->getZExtValue() < NumLanes)
+            Lanes.clearBit(Idx->getZExtValue());
+        return Lanes;
+    }
+    if (auto *SV = dyn_cast<ShuffleVectorInst>(User)) {
+        if (U.getOperandNo() > 1)
+            return All;
+        APInt Lanes = None;
+        ArrayRef<int> Mask = SV->getShuffleMask();
+        for (unsigned I = 0, E = Mask.size(); I != E; ++I) {
+            if (!Result[I] || Mask[I] < 0)
+                continue;
+            unsigned Lane = Mask[I];
+            unsigned FromOp = Lane >= NumLanes;
+            if (FromOp == U.getOperandNo())
+                Lanes.setBit(Lane - FromOp * NumLanes);
+        }
+        return Lanes;
+    }
+    // The condition of a vector select is lane-wise as well
+    if (isLaneWise(User) && getVectorType(U.get())->getNumElements() ==
+                                    Result.getBitWidth())
+        return Result;
+    return All;
+}
+
+unsigned getRegisters(uint64_t Bits, unsigned Width) {
+    return static_cast<unsigned>(divideCeil(Bits, Width));
+}
+
+// Lanes from the lowest to the highest demanded one
+unsigned getLaneSpan(const APInt &Lanes) {
+    if (Lanes.isNullValue())
+        return 0;
+    return Lanes.getActiveBits() - Lanes.countTrailingZeros();
+}
+} // namespace
+
+PreservedAnalyses VectorLanesPass::run(Function &F,
+                                       FunctionAnalysisManager &FAM) {
+    auto &LS = FAM.getResult<LiveSetsAnalysis>(F);
+    const DataLayout &DL = F.getParent()->getDataLayout();
+
+    // STEP 1: Demanded lanes
+    SmallVector<unsigned, 16> Vectors;
+    DenseMap<const Value *, APInt> Demanded;
+    for (unsigned Idx = 0, E = LS.getNumValues(); Idx != E; ++Idx)
+        if (auto *VTy = getVectorType(LS.getValue(Idx))) {
+            Vectors.push_back(Idx);
+            Demanded[LS.getValue(Idx)] =
+                    APInt::getNullValue(VTy->getNumElements());
+        }
+    if (Vectors.empty())
+        return PreservedAnalyses::all();
+
+    bool Changed = true;
+    while (Changed) {
+        Changed = false;
+        // Uses mostly come after definitions, visit values in reverse
+        for (unsigned Idx : reverse(Vectors)) {
+            Value *V = LS.getValue(Idx);
+            APInt &Lanes = Demanded.find(V)->second;
+            APInt New = Lanes;
+            for (const Use &U : V->uses())
+                New |= getDemandedByUse(U, Lanes.getBitWidth(), Demanded);
+            if (New != Lanes) {
+                Lanes = std::move(New);
+                Changed = true;
+            }
+        }
+    }
+
+    // STEP 2: Registers per value before and after narrowing
+    std::vector<unsigned> Wide(LS.getNumValues()), Narrow(LS.getNumValues());
+    BitVector Narrowable(LS.getNumValues());
+    for (unsigned Idx : Vectors) {
+        Value *V = LS.getValue(Idx);
+        auto *VTy = getVectorType(V);
+        uint64_t LaneBits = DL.getTypeSizeInBits(VTy->getElementType());
+        unsigned Span = getLaneSpan(Demanded.find(V)->second);
+        Wide[Idx] = getRegisters(LaneBits * VTy->getNumElements(), Width);
+        Narrow[Idx] = std::max(getRegisters(LaneBits * Span, Width), 1u);
+        if (Narrow[Idx] < Wide[Idx])
+            Narrowable.set(Idx);
+    }
+
+    // STEP 3: Peak vector register pressure per block
+    auto Pressure = [&](const BitVector &Live,
+                        const std::vector<unsigned> &Regs) {
+        unsigned P = 0;
+        for (unsigned Idx : Live.set_bits())
+            P += Regs[Idx];
+        return P;
+    };
+
+    raw_ostream &OutS = errs();
+    OutS << "=================================================\n";
+    OutS << "Vector lane liveness for function " << F.getName() << " ("
+         << Width << "-bit registers)\n";
+    OutS << "=================================================\n";
+    OutS << format("vector values %u, narrowable %u\n",
+                   static_cast<unsigned>(Vectors.size()),
+                   Narrowable.count());
+    for (unsigned Idx : Narrowable.set_bits()) {
+        Value *V = LS.getValue(Idx);
+        std::string DummyStr;
+        raw_string_ostream InstrStr(DummyStr);
+        V->print(InstrStr);
+        OutS << format("==>%s\n", InstrStr.str().c_str());
+        OutS << format("   lanes %u/%u, registers %u -> %u\n",
+                       Demanded.find(V)->second.countPopulation(),
+                       getVectorType(V)->getNumElements(), Wide[Idx],
+                       Narrow[Idx]);
+    }
+    for (const BasicBlock &BB : F) {
+        unsigned PeakWide = Pressure(LS.getLiveIn(&BB), Wide);
+        unsigned PeakNarrow = Pressure(LS.getLiveIn(&BB), Narrow);
+        LS.walkBlockBackward(BB,
+                             [&](const Instruction &, const BitVector &Live) {
+                                 PeakWide = std::max(PeakWide,
+                                                     Pressure(Live, Wide));
+                                 PeakNarrow = std::max(
+                                         PeakNarrow, Pressure(Live, Narrow));
+                             });
+        if (PeakWide == PeakNarrow)
+            continue;
+        std::string DummyStr;
+        raw_string_ostream BBIdStream(DummyStr);
+        BB.printAsOperand(BBIdStream, false);
+        OutS << format("[[BasicBlock %s]] vector registers %u -> %u\n",
+                       BBIdStream.str().c_str(), PeakWide, PeakNarrow);
+    }
+    OutS << "-------------------------------------------------\n\n";
+
+    return PreservedAnalyses::all();
+}
+
+} // namespace liveness
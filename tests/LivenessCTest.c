@@ -0,0 +1,182 @@
+/*===----------------------------------------------------------------------===*\
+ * DESCRIPTION:
+ *    Driver for the C interface (see LivenessC.h), run by tests/liveness-c.ll.
+ *    For every function defined in the IR file given on the command line it
+ *    prints the block live sets through the C API and checks that all entry
+ *    points agree with each other:
+ *      * LiveSetNext, LiveSetContains and LiveSetSize describe the same set
+ *      * the point queries match the sets
+ *      * the set after an instruction is the set before the next one
+ *      * the cache returns the same analysis until the function is
+ *        invalidated, and a fresh one afterwards
+ *    and that untracked values and out-of-range ordinals are rejected.
+ *    Failed checks are printed as "FAILED: ..." and make the exit status 1.
+ *
+ *    Built as 'liveness-c-test' with -DLIVENESS_BUILD_C_TEST=ON:
+ *      liveness-c-test input.ll
+\*===----------------------------------------------------------------------===*/
+#include "LivenessC.h"
+
+#include "llvm-c/Core.h"
+#include "llvm-c/IRReader.h"
+
+#include <stdio.h>
+
+static unsigned Failures = 0;
+
+#define EXPECT(Cond)                                                          \
+    do {                                                                      \
+        if (!(Cond)) {                                                        \
+            printf("FAILED: %s (line %d)\n", #Cond, __LINE__);                \
+            ++Failures;                                                       \
+        }                                                                     \
+    } while (0)
+
+static void printValue(LLVMValueRef V) {
+    size_t Len;
+    const char *Name = LLVMGetValueName2(V, &Len);
+    printf(" %%%.*s", (int)Len, Name);
+}
+
+/* Checks that the three views of S agree; prints S if Label is set */
+static void checkSet(LivenessRef L, LiveSetRef S, const char *Label) {
+    unsigned NumValues = LivenessGetNumValues(L), Count = 0, Idx;
+    int Next;
+    if (Label)
+        printf("  %s:", Label);
+    for (Next = LiveSetNext(S, -1); Next >= 0; Next = LiveSetNext(S, Next)) {
+        EXPECT((unsigned)Next < NumValues);
+        EXPECT(LiveSetContains(S, Next));
+        if (Label)
+            printValue(LivenessGetValue(L, Next));
+        ++Count;
+    }
+    if (Label)
+        printf(" (%u)\n", Count);
+    EXPECT(LiveSetSize(S) == Count);
+    for (Idx = 0; Idx != NumValues; ++Idx)
+        Count -= LiveSetContains(S, Idx) ? 1 : 0;
+    EXPECT(Count == 0);
+    /* Out of range */
+    EXPECT(!LiveSetContains(S, NumValues));
+    EXPECT(!LiveSetContains(S, NumValues + 64));
+}
+
+static LLVMBool setsEqual(LivenessRef L, LiveSetRef A, LiveSetRef B) {
+    unsigned Idx;
+    for (Idx = 0; Idx != LivenessGetNumValues(L); ++Idx)
+        if (LiveSetContains(A, Idx) != LiveSetContains(B, Idx))
+            return 0;
+    return 1;
+}
+
+static void checkBlock(LivenessRef L, LLVMBasicBlockRef BB) {
+    LiveSetRef LiveIn = LivenessGetLiveIn(L, BB);
+    LiveSetRef LiveOut = LivenessGetLiveOut(L, BB);
+    LLVMValueRef Inst;
+    unsigned Idx;
+
+    printf("[[BasicBlock %%%s]]\n", LLVMGetBasicBlockName(BB));
+    checkSet(L, LiveIn, "live-in");
+    checkSet(L, LiveOut, "live-out");
+    for (Idx = 0; Idx != LivenessGetNumValues(L); ++Idx) {
+        LLVMValueRef V = LivenessGetValue(L, Idx);
+        EXPECT(LivenessIsLiveIn(L, V, BB) == LiveSetContains(LiveIn, Idx));
+        EXPECT(LivenessIsLiveOut(L, V, BB) == LiveSetContains(LiveOut, Idx));
+    }
+
+    for (Inst = LLVMGetFirstInstruction(BB); Inst;
+         Inst = LLVMGetNextInstruction(Inst)) {
+        LLVMValueRef Next = LLVMGetNextInstruction(Inst);
+        LiveSetRef After = LivenessGetLiveAfter(L, Inst);
+        checkSet(L, After, NULL);
+        for (Idx = 0; Idx != LivenessGetNumValues(L); ++Idx)
+            EXPECT(LivenessIsLiveAfter(L, LivenessGetValue(L, Idx), Inst) ==
+                   LiveSetContains(After, Idx));
+        if (Next && !LLVMIsAPHINode(Next)) {
+            LiveSetRef Before = LivenessGetLiveBefore(L, Next);
+            checkSet(L, Before, NULL);
+            EXPECT(setsEqual(L, After, Before));
+            LiveSetDispose(Before);
+        }
+        if (!Next)
+            EXPECT(setsEqual(L, After, LiveOut));
+        LiveSetDispose(After);
+    }
+    LiveSetDispose(LiveIn);
+    LiveSetDispose(LiveOut);
+}
+
+static void checkFunction(LLVMValueRef Fn, LivenessCacheRef Cache) {
+    LivenessRef L = LivenessCreate(Fn), Cached;
+    LLVMBasicBlockRef Entry = LLVMGetEntryBasicBlock(Fn);
+    LLVMValueRef Term = LLVMGetBasicBlockTerminator(Entry);
+    LLVMValueRef Const = LLVMConstInt(LLVMInt32Type(), 7, 0);
+    LLVMValueRef Extra;
+    LLVMBuilderRef Builder;
+    LLVMBasicBlockRef BB;
+    unsigned NumValues = LivenessGetNumValues(L), Idx;
+
+    printf("function @%s: %u values\n", LLVMGetValueName(Fn), NumValues);
+    for (Idx = 0; Idx != NumValues; ++Idx)
+        EXPECT(LivenessGetIndex(L, LivenessGetValue(L, Idx)) == (int)Idx);
+    for (BB = Entry; BB; BB = LLVMGetNextBasicBlock(BB))
+        checkBlock(L, BB);
+
+    /* Untracked values: constants, globals, void instructions */
+    EXPECT(LivenessGetIndex(L, Const) == -1);
+    EXPECT(LivenessGetIndex(L, Fn) == -1);
+    EXPECT(LivenessGetIndex(L, Term) == -1);
+    EXPECT(!LivenessIsLiveIn(L, Const, Entry));
+    EXPECT(!LivenessIsLiveOut(L, Fn, Entry));
+    EXPECT(!LivenessIsLiveAfter(L, Const, Term));
+
+    /* The cache computes once and again after invalidation */
+    Cached = LivenessCacheGet(Cache, Fn);
+    EXPECT(LivenessCacheGet(Cache, Fn) == Cached);
+    EXPECT(LivenessGetNumValues(Cached) == NumValues);
+    Builder = LLVMCreateBuilder();
+    LLVMPositionBuilderBefore(Builder, Term);
+    Extra = LLVMBuildAlloca(Builder, LLVMInt32Type(), "extra");
+    LLVMDisposeBuilder(Builder);
+    LivenessCacheInvalidate(Cache, Fn);
+    Cached = LivenessCacheGet(Cache, Fn);
+    EXPECT(LivenessGetIndex(Cached, Extra) >= 0);
+    printf("cache: %u -> %u values\n", NumValues,
+           LivenessGetNumValues(Cached));
+    LLVMInstructionEraseFromParent(Extra);
+    LivenessCacheInvalidate(Cache, Fn);
+    EXPECT(LivenessGetNumValues(LivenessCacheGet(Cache, Fn)) == NumValues);
+
+    LivenessDispose(L);
+}
+
+int main(int argc, char **argv) {
+    LLVMMemoryBufferRef Buffer;
+    LLVMModuleRef M;
+    LivenessCacheRef Cache;
+    LLVMValueRef Fn;
+    char *Message;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: liveness-c-test input.ll\n");
+        return 1;
+    }
+    if (LLVMCreateMemoryBufferWithContentsOfFile(argv[1], &Buffer,
+                                                 &Message) ||
+        LLVMParseIRInContext(LLVMGetGlobalContext(), Buffer, &M, &Message)) {
+        fprintf(stderr, "liveness-c-test: %s\n", Message);
+        LLVMDisposeMessage(Message);
+        return 1;
+    }
+
+    Cache = LivenessCacheCreate();
+    for (Fn = LLVMGetFirstFunction(M); Fn; Fn = LLVMGetNextFunction(Fn))
+        if (!LLVMIsDeclaration(Fn))
+            checkFunction(Fn, Cache);
+    LivenessCacheDispose(Cache);
+    LLVMDisposeModule(M);
+
+    printf("liveness-c-test: %u failures\n", Failures);
+    return Failures != 0;
+}
@@ -0,0 +1,62 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes=attach-liveness -S %s -o %t 2>&1 | FileCheck %s --check-prefix=FIRST
+; RUN: FileCheck %s --check-prefix=IR < %t
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='attach-liveness<verify>' -disable-output %t 2>&1 | FileCheck %s --check-prefix=SECOND
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='print<live-sets>' -disable-output %t 2>&1 > %t.loaded
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='print<live-sets>' -disable-output %s 2>&1 > %t.computed
+; RUN: diff %t.loaded %t.computed
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='instcombine,attach-liveness' -disable-output %t 2>&1 | FileCheck %s --check-prefix=CHANGED
+
+; Verifies that live-in sets are attached as function metadata, that they are
+; reused (and identical to a fresh computation, live-outs included) while the
+; function is unchanged, and that a transformation invalidates them.
+
+define i32 @loop(i32 %a, i32 %n) {
+entry:
+  %base = mul i32 %a, 3
+  br label %body
+
+body:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]
+  %s = phi i32 [ %base, %entry ], [ %s.next, %body ]
+  %s.next = add i32 %s, %a
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %body, label %exit
+
+exit:
+  ret i32 %s.next
+}
+
+define i32 @fold(i32 %a) {
+entry:
+  %x = add i32 %a, 0
+  br label %next
+
+next:
+  ret i32 %x
+}
+
+define void @empty() {
+entry:
+  ret void
+}
+
+; FIRST: attach-liveness @loop: 8 values, 3 blocks, computed
+; FIRST: attach-liveness @fold: 2 values, 2 blocks, computed
+; FIRST: attach-liveness @empty: 0 values, 1 blocks, computed
+
+; IR: define i32 @loop(i32 %a, i32 %n) !liveness.live-in ![[LOOP:[0-9]+]]
+; IR: define i32 @fold(i32 %a) !liveness.live-in ![[FOLD:[0-9]+]]
+; IR: define void @empty() !liveness.live-in ![[EMPTY:[0-9]+]]
+; loop: entry {a, n}, body {a, n}, exit {s.next}
+; IR-DAG: ![[LOOP]] = !{i64 {{-?[0-9]+}}, i64 8, [3 x i64] [i64 3, i64 3, i64 32]}
+; fold: entry {a}, next {x}
+; IR-DAG: ![[FOLD]] = !{i64 {{-?[0-9]+}}, i64 2, [2 x i64] [i64 1, i64 2]}
+; IR-DAG: ![[EMPTY]] = !{i64 {{-?[0-9]+}}, i64 0, [0 x i64] zeroinitializer}
+
+; SECOND: attach-liveness @loop: 8 values, 3 blocks, reused, verified
+; SECOND: attach-liveness @fold: 2 values, 2 blocks, reused, verified
+; SECOND: attach-liveness @empty: 0 values, 1 blocks, reused
+
+; CHANGED: attach-liveness @loop: 8 values, 3 blocks, reused
+; CHANGED: attach-liveness @fold: 1 values, 2 blocks, computed
@@ -0,0 +1,36 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes=call-crossing -disable-output %s 2>&1 | FileCheck %s
+
+; Verifies the values live across each call, by register class: the call
+; in the loop keeps the induction variable, the first call's result and %n
+; alive, plus the double and the vector needed after the loop, and it is
+; weighted by the loop frequency.
+
+declare i32 @g(i32)
+declare void @h()
+
+define double @f(i32 %a, double %d, <4 x float> %v, i32 %n) {
+entry:
+  %x = add i32 %a, 1
+  %c1 = call i32 @g(i32 %x)
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  call void @h()
+  %i.next = add i32 %i, %c1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %e = extractelement <4 x float> %v, i32 0
+  %ef = fpext float %e to double
+  %r = fadd double %d, %ef
+  ret double %r
+}
+
+; CHECK-LABEL: Values live across calls in function f
+; CHECK: calls 2, live across: int 4, fp 2, vector 2, weighted
+; CHECK-NEXT: ==>  %c1 = call i32 @g(i32 %x)
+; CHECK-NEXT: int 1, fp 1, vector 1 (freq 1.00)
+; CHECK-NEXT: ==>  call void @h()
+; CHECK-NEXT: int 3, fp 1, vector 1
@@ -0,0 +1,62 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes=coro-liveness -disable-output %s 2>&1 | FileCheck %s
+
+; Verifies the values live across a suspend point. %buf itself is only used
+; before the suspend, but it is read through %bufp after resume, so its 64
+; bytes stay in the frame; %y and %bufp can be recomputed after resume.
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+declare token @llvm.coro.id(i32, i8*, i8*, i8*)
+declare i32 @llvm.coro.size.i32()
+declare i8* @llvm.coro.begin(token, i8*)
+declare i8 @llvm.coro.suspend(token, i1)
+declare i8* @llvm.coro.free(token, i8*)
+declare i1 @llvm.coro.end(i8*, i1)
+declare i8* @malloc(i32)
+declare void @free(i8*)
+declare void @use(i32)
+
+define i8* @f(i32 %n) "coroutine.presplit"="0" {
+entry:
+  %buf = alloca [64 x i8]
+  %id = call token @llvm.coro.id(i32 0, i8* null, i8* null, i8* null)
+  %size = call i32 @llvm.coro.size.i32()
+  %alloc = call i8* @malloc(i32 %size)
+  %hdl = call noalias i8* @llvm.coro.begin(token %id, i8* %alloc)
+  %x = add i32 %n, 1
+  %y = mul i32 %x, 2
+  %dead = add i32 %n, 7
+  call void @use(i32 %dead)
+  %bufp = getelementptr [64 x i8], [64 x i8]* %buf, i32 0, i32 0
+  store i8 1, i8* %bufp
+  %s = call i8 @llvm.coro.suspend(token none, i1 false)
+  switch i8 %s, label %suspend [i8 0, label %resume
+                                i8 1, label %cleanup]
+
+resume:
+  call void @use(i32 %y)
+  call void @use(i32 %x)
+  %b = load i8, i8* %bufp
+  %bz = zext i8 %b to i32
+  call void @use(i32 %bz)
+  br label %cleanup
+
+cleanup:
+  %mem = call i8* @llvm.coro.free(token %id, i8* %hdl)
+  call void @free(i8* %mem)
+  br label %suspend
+
+suspend:
+  %unused = call i1 @llvm.coro.end(i8* %hdl, i1 false)
+  ret i8* %hdl
+}
+
+; CHECK-LABEL: Coroutine frame liveness for function f
+; CHECK:       {{\[\[}}Suspend %s in block %entry]]
+; CHECK-NEXT:  live across: 4 values, 80 bytes (CoroSplit: 4 values, 80 bytes)
+; CHECK-NEXT:  ==>  %buf = alloca [64 x i8]
+; CHECK-NEXT:  ==>  %x = add i32 %n, 1
+; CHECK-NEXT:  =>*  %y = mul i32 %x, 2
+; CHECK-NEXT:  =>*  %bufp = getelementptr [64 x i8], [64 x i8]* %buf, i32 0, i32 0
+; CHECK-NEXT:  recomputable after resume: 2 values, frame 68 bytes without them
+; CHECK:       Frame: 80 bytes (CoroSplit: 80 bytes)
@@ -0,0 +1,59 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='print<interference>' -disable-output %s 2>&1 | FileCheck %s
+
+; Verifies InterferenceQuery on a loop. %base and %n are live across the back
+; edge and interfere with everything defined in the loop. The phis interfere
+; with each other, but each one ends where its increment is defined, so the
+; increments coalesce with their phis. Values in different arms of a branch
+; do not interfere. findInterference returns the first interfering value.
+
+define i32 @loop(i32 %n) {
+entry:
+  %base = add i32 %n, 1
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %s.next = add i32 %s, %base
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %s.next
+}
+
+; CHECK-LABEL: Interference for function loop
+; CHECK-NEXT:  =====
+; CHECK-NEXT:  %n:{{$}}
+; CHECK-NEXT:  %base: %n (first %n)
+; CHECK-NEXT:  %i: %n %base (first %n)
+; CHECK-NEXT:  %s: %n %base %i (first %n)
+; CHECK-NEXT:  %s.next: %n %base %i (first %n)
+; CHECK-NEXT:  %i.next: %n %base %s.next (first %n)
+; CHECK-NEXT:  %c: %n %base %s.next %i.next (first %n)
+
+define i32 @diamond(i1 %c, i32 %a) {
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  %x = add i32 %a, 1
+  br label %join
+
+else:
+  %y = mul i32 %a, 3
+  br label %join
+
+join:
+  %r = phi i32 [ %x, %then ], [ %y, %else ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: Interference for function diamond
+; CHECK-NEXT:  =====
+; CHECK-NEXT:  %c:{{$}}
+; CHECK-NEXT:  %a: %c (first %c)
+; CHECK-NEXT:  %x:{{$}}
+; CHECK-NEXT:  %y:{{$}}
+; CHECK-NEXT:  %r:{{$}}
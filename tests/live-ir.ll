@@ -0,0 +1,49 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes=print-live-ir -disable-output %s 2>&1 | FileCheck %s
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='print-live-ir<insts;delta>' -disable-output %s 2>&1 | FileCheck %s --check-prefix=DELTA
+
+; Verifies that the IR is printed once with the live sets as comments, by
+; block or as changes after every instruction.
+
+; CHECK-LABEL: define i32 @foo
+; CHECK: entry:
+; CHECK-NEXT: ; live-in: %a %b %n (3)
+; CHECK-NEXT: %0 = add i32 %a, 1{{$}}
+; CHECK: br label %loop{{$}}
+; CHECK-NEXT: ; live-out: %b %n %0 %y (4)
+; CHECK: loop:
+; CHECK-NEXT: ; live-in: %n %0 %y (3)
+; CHECK: ; live-out: %n %0 %y %acc.next %i.next (5)
+; CHECK: exit:
+; CHECK-NEXT: ; live-in: %y %acc.next (2)
+; CHECK: ; live-out: (0)
+
+; DELTA-LABEL: define i32 @foo
+; DELTA: ; live-in: %a %b %n (3)
+; DELTA-NEXT: %0 = add i32 %a, 1 ; +%0
+; DELTA-NEXT: %y = mul i32 %a, %b ; +%y -%a
+; DELTA-NEXT: br label %loop ; =
+; DELTA-NEXT: ; live-out: +%0 +%y -%a
+; DELTA: %acc.next = add i32 %acc, %0 ; +%acc.next -%acc
+; DELTA: br i1 %cmp, label %loop, label %exit ; -%cmp
+; DELTA: %r = add i32 %acc.next, %y ; +%r -%y -%acc.next
+; DELTA-NEXT: ret i32 %r ; -%r
+; DELTA-NEXT: ; live-out: -%y -%acc.next
+
+define i32 @foo(i32 %a, i32 %b, i32 %n) {
+entry:
+  %0 = add i32 %a, 1
+  %y = mul i32 %a, %b
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ %b, %entry ], [ %acc.next, %loop ]
+  %acc.next = add i32 %acc, %0
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %r = add i32 %acc.next, %y
+  ret i32 %r
+}
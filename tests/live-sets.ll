@@ -0,0 +1,35 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='print<live-sets>' -disable-output %s 2>&1 | FileCheck %s
+
+; Verifies the live-in/live-out sets of a loop. Phi operands are live-out of
+; the incoming block only, and values used after the loop stay live around
+; the back edge.
+
+define i32 @foo(i32 %a, i32 %b, i32 %n) {
+entry:
+  %x = add i32 %a, 1
+  %y = mul i32 %a, %b
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ %b, %entry ], [ %acc.next, %loop ]
+  %acc.next = add i32 %acc, %x
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %r = add i32 %acc.next, %y
+  ret i32 %r
+}
+
+; CHECK-LABEL: Live sets for function foo
+; CHECK-LABEL: BasicBlock %entry]] max pressure 4
+; CHECK-NEXT:    live-in:  %a %b %n
+; CHECK-NEXT:    live-out: %b %n %x %y
+; CHECK-LABEL: BasicBlock %loop]] max pressure 6
+; CHECK-NEXT:    live-in:  %n %x %y
+; CHECK-NEXT:    live-out: %n %x %y %acc.next %i.next
+; CHECK-LABEL: BasicBlock %exit]] max pressure 2
+; CHECK-NEXT:    live-in:  %y %acc.next
+; CHECK-NEXT:    live-out: {{$}}
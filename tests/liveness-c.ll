@@ -0,0 +1,39 @@
+; REQUIRES: liveness-c-test
+; RUN: %shlibdir/liveness-c-test %s | FileCheck %s
+
+; Verifies the C interface (LivenessC.h) through tests/LivenessCTest.c, which
+; calls every entry point, including the rejection of untracked values and
+; out-of-range ordinals, and reports any disagreement as FAILED. Only built
+; with -DLIVENESS_BUILD_C_TEST=ON.
+
+@g = global i32 0
+
+define i32 @loop(i32 %n) {
+entry:
+  %start = add i32 %n, 1
+  br label %body
+
+body:
+  %i = phi i32 [ 0, %entry ], [ %next, %body ]
+  %next = add i32 %i, %start
+  %done = icmp sgt i32 %next, %n
+  br i1 %done, label %exit, label %body
+
+exit:
+  store i32 %next, i32* @g
+  ret i32 %i
+}
+
+; CHECK-NOT: FAILED
+; CHECK: function @loop: 5 values
+; CHECK-NEXT: {{\[\[}}BasicBlock %entry]]
+; CHECK-NEXT:   live-in: %n (1)
+; CHECK-NEXT:   live-out: %n %start (2)
+; CHECK-NEXT: {{\[\[}}BasicBlock %body]]
+; CHECK-NEXT:   live-in: %n %start (2)
+; CHECK-NEXT:   live-out: %n %start %i %next (4)
+; CHECK-NEXT: {{\[\[}}BasicBlock %exit]]
+; CHECK-NEXT:   live-in: %i %next (2)
+; CHECK-NEXT:   live-out: (0)
+; CHECK-NEXT: cache: 5 -> 6 values
+; CHECK-NEXT: liveness-c-test: 0 failures
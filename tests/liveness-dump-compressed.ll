@@ -0,0 +1,30 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='liveness-dump<output=%t;compress=zlib;chunk=1>' -disable-output %s
+; RUN: %python -c "import sys, zlib; d = open(sys.argv[1], 'rb').read(); out = b''; exec('while d:\n o = zlib.decompressobj(); out += o.decompress(d); d = o.unused_data'); sys.stdout.write(out.decode())" %t | FileCheck %s
+
+; Verifies that the compressed RIV dump, written as a sequence of 1 KiB zlib
+; chunks, decompresses to the plain report of every function.
+
+define i32 @first(i32 %a) {
+entry:
+  %add = add i32 %a, 1
+  ret i32 %add
+}
+
+define i32 @second(i32 %b) {
+entry:
+  %mul = mul i32 %b, 2
+  ret i32 %mul
+}
+
+define i32 @third(i32 %c) {
+entry:
+  %sub = sub i32 %c, 3
+  ret i32 %sub
+}
+
+; CHECK:      Reachable Value analysis results
+; CHECK:      ==>i32 %a
+; CHECK:      Reachable Value analysis results
+; CHECK:      ==>i32 %b
+; CHECK:      Reachable Value analysis results
+; CHECK:      ==>i32 %c
@@ -0,0 +1,91 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='liveness-dump<profile=hot>' -disable-output %s 2>&1 | FileCheck %s --check-prefix=HOT
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='liveness-dump<profile=approx;threads=2>' -disable-output %s 2>&1 | FileCheck %s --check-prefix=APPROX
+
+; Verifies that with a profile only functions with a hot entry get the exact
+; RIV: the others are skipped (profile=hot) or get the approximate RIV, where
+; a join block only sees the values reaching or defined in the entry block
+; (profile=approx).
+
+@g = global i32 0
+
+define i32 @hot(i32 %a) !prof !20 {
+entry:
+  %x = add i32 %a, 1
+  br i1 undef, label %left, label %join
+
+left:
+  br label %join
+
+join:
+  ret i32 %x
+}
+
+define i32 @warm(i32 %a) !prof !21 {
+entry:
+  %x = add i32 %a, 1
+  br i1 undef, label %left, label %join
+
+left:
+  %y = mul i32 %x, 2
+  br label %join
+
+join:
+  ret i32 %x
+}
+
+define i32 @cold(i32 %a) !prof !22 {
+entry:
+  ret i32 %a
+}
+
+; HOT: Reachable Value analysis results
+; HOT-NEXT: =================================================
+; HOT-NEXT: {{\[\[}}BasicBlock %entry]]
+; HOT-NEXT: ==>@g = global i32 0
+; HOT-NEXT: ==>i32 %a
+; HOT: {{\[\[}}BasicBlock %join]]
+; HOT-NEXT: ==>@g = global i32 0
+; HOT-NEXT: ==>i32 %a
+; HOT-NEXT: ==>  %x = add i32 %a, 1
+; HOT-NOT: Reachable Value
+; HOT: liveness-dump: 1 hot functions, 0 approximated, 2 skipped
+
+; APPROX: Reachable Value analysis results
+; APPROX-NOT: approximate
+; APPROX: Reachable Value analysis results (approximate)
+; APPROX-NEXT: =================================================
+; APPROX-NEXT: {{\[\[}}BasicBlock %entry]]
+; APPROX-NEXT: ==>@g = global i32 0
+; APPROX-NEXT: ==>i32 %a
+; APPROX-NEXT: -------------------------------------------------
+; APPROX-NEXT: {{\[\[}}BasicBlock %left]]
+; APPROX-NEXT: ==>@g = global i32 0
+; APPROX-NEXT: ==>i32 %a
+; APPROX-NEXT: ==>  %x = add i32 %a, 1
+; APPROX-NEXT: -------------------------------------------------
+; APPROX-NEXT: {{\[\[}}BasicBlock %join]]
+; APPROX-NEXT: ==>@g = global i32 0
+; APPROX-NEXT: ==>i32 %a
+; APPROX-NEXT: ==>  %x = add i32 %a, 1
+; APPROX-NEXT: -------------------------------------------------
+; APPROX: Reachable Value analysis results (approximate)
+; APPROX: liveness-dump: 1 hot functions, 2 approximated, 0 skipped
+
+!llvm.module.flags = !{!0}
+!0 = !{i32 1, !"ProfileSummary", !1}
+!1 = !{!2, !3, !4, !5, !6, !7, !8, !9}
+!2 = !{!"ProfileFormat", !"InstrProf"}
+!3 = !{!"TotalCount", i64 10000}
+!4 = !{!"MaxCount", i64 1000}
+!5 = !{!"MaxInternalCount", i64 1}
+!6 = !{!"MaxFunctionCount", i64 1000}
+!7 = !{!"NumCounts", i64 3}
+!8 = !{!"NumFunctions", i64 3}
+!9 = !{!"DetailedSummary", !10}
+!10 = !{!11, !12, !13}
+!11 = !{i32 10000, i64 1000, i32 1}
+!12 = !{i32 999000, i64 100, i32 2}
+!13 = !{i32 999999, i64 1, i32 3}
+!20 = !{!"function_entry_count", i64 1000}
+!21 = !{!"function_entry_count", i64 50}
+!22 = !{!"function_entry_count", i64 1}
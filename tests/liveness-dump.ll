@@ -0,0 +1,64 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='liveness-dump<threads=4>' -disable-output %s 2>&1 | FileCheck %s
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='liveness-dump<threads=4;output=%t;shard=1>' -disable-output %s
+; RUN: FileCheck --check-prefix=INDEX %s < %t.index
+; RUN: FileCheck --check-prefix=SHARD %s < %t.1
+; RUN: not opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='liveness-dump<shard=1>' -disable-output %s 2>&1 | FileCheck --check-prefix=NO-OUTPUT %s
+; RUN: not opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='liveness-dump<compress=bogus>' -disable-output %s 2>&1 | FileCheck --check-prefix=BAD-COMPRESS %s
+; RUN: not opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='liveness-dump<threads=x>' -disable-output %s 2>&1 | FileCheck --check-prefix=BAD-THREADS %s
+; RUN: not opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='liveness-dump<thread=4>' -disable-output %s 2>&1 | FileCheck --check-prefix=UNKNOWN %s
+
+; Verifies that the module-wide RIV dump, formatted in parallel, keeps the
+; functions in module order and the values of every block in IR order, both
+; on one stream and split into one shard file per function. Shards need an
+; output file name, and invalid or unknown parameters are rejected without a
+; crash.
+
+@g = global i32 0
+
+define i32 @first(i32 %a, i32 %b) {
+entry:
+  %add = add i32 %a, %b
+  br label %exit
+
+exit:
+  ret i32 %add
+}
+
+define i32 @second(i32 %c) {
+entry:
+  %mul = mul i32 %c, 2
+  ret i32 %mul
+}
+
+; CHECK:      BasicBlock %entry]]
+; CHECK-NEXT: ==>@g = global i32 0
+; CHECK-NEXT: ==>i32 %a
+; CHECK-NEXT: ==>i32 %b
+; CHECK:      BasicBlock %exit]]
+; CHECK-NEXT: ==>@g = global i32 0
+; CHECK-NEXT: ==>i32 %a
+; CHECK-NEXT: ==>i32 %b
+; CHECK-NEXT: ==>  %add = add i32 %a, %b
+; CHECK-NEXT: ---
+; CHECK:      BasicBlock %entry]]
+; CHECK-NEXT: ==>@g = global i32 0
+; CHECK-NEXT: ==>i32 %c
+
+; INDEX:      .0: first .. first
+; INDEX-NEXT: .1: second .. second
+
+; SHARD:      BasicBlock %entry]]
+; SHARD-NEXT: ==>@g = global i32 0
+; SHARD-NEXT: ==>i32 %c
+
+; NO-OUTPUT: liveness-dump: sharded output needs 'output'
+; NO-OUTPUT-NOT: Stack dump
+
+; BAD-COMPRESS: liveness-dump: invalid value for pass parameter 'compress': bogus
+; BAD-COMPRESS-NOT: Stack dump
+
+; BAD-THREADS: liveness-dump: invalid value for pass parameter 'threads': x
+; BAD-THREADS-NOT: Stack dump
+
+; UNKNOWN: liveness-dump: unknown pass parameter 'thread'
+; UNKNOWN-NOT: Stack dump
@@ -0,0 +1,50 @@
+; REQUIRES: liveness-jit
+; RUN: %shlibdir/liveness-jit %s -repeat=2 2> %t.err | FileCheck %s
+; RUN: FileCheck %s --check-prefix=BENCH < %t.err
+
+; Verifies PressureHintsTransform inside an LLJIT: every function
+; materialised through the IRTransformLayer carries the same hints as
+; 'pressure-hints' attaches in opt, a function that already has hints keeps
+; them, and the next transform in the chain reads them back. Only built with
+; -DLIVENESS_BUILD_JIT=ON.
+
+define i32 @straight(i32 %a, i32 %b) {
+entry:
+  %x = add i32 %a, %b
+  %y = mul i32 %x, %a
+  %z = sub i32 %y, %b
+  ret i32 %z
+}
+
+define i32 @loop(i32 %a, i32 %n) {
+entry:
+  %slot = alloca i32
+  store i32 %a, i32* %slot
+  br label %body
+
+body:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %body ]
+  %v = load i32, i32* %slot
+  %s.next = add i32 %s, %v
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %body, label %exit
+
+exit:
+  ret i32 %s.next
+}
+
+define i32 @annotated(i32 %a) #0 {
+entry:
+  ret i32 %a
+}
+
+; CHECK-DAG: @straight: max pressure 3, avg 1.50
+; CHECK-DAG: @loop: max pressure 4, avg {{[0-9.]+}}
+; CHECK-DAG: @annotated: max pressure 9, avg 9.00
+; BENCH: liveness-jit: 3 functions, 16 instructions (2 runs)
+; BENCH-NEXT: hints {{[0-9.]+}} ms of {{[0-9.]+}} ms materialisation
+; BENCH-NEXT: hints per function {{[0-9.]+}} us, per instruction {{[0-9.]+}} ns
+
+attributes #0 = { "liveness-avg-pressure"="9.00" "liveness-max-pressure"="9" }
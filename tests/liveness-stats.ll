@@ -0,0 +1,59 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='liveness-stats<rate=1;strata=2>' -disable-output %s 2>&1 | FileCheck %s
+
+; Verifies the size strata and the extrapolated statistics. With rate=1
+; every function is analysed, so the estimates are exact and the confidence
+; intervals are empty.
+
+define i32 @one(i32 %a) {
+entry:
+  ret i32 %a
+}
+
+define i32 @two(i32 %a, i32 %b) {
+entry:
+  %s = add i32 %a, %b
+  ret i32 %s
+}
+
+define i32 @loop(i32 %a, i32 %n) {
+entry:
+  br label %body
+
+body:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]
+  %i.next = add i32 %i, %a
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %body, label %exit
+
+exit:
+  ret i32 %i.next
+}
+
+define i32 @diamond(i32 %a, i32 %b, i1 %c) {
+entry:
+  br i1 %c, label %l, label %r
+
+l:
+  %x = add i32 %a, 1
+  br label %join
+
+r:
+  %y = mul i32 %b, 2
+  br label %join
+
+join:
+  %p = phi i32 [ %x, %l ], [ %y, %r ]
+  ret i32 %p
+}
+
+; CHECK-LABEL: Liveness statistics (4 of 4 functions sampled, 2 strata)
+; CHECK:      stratum 0: 1-1 blocks, 2 functions, 2 sampled
+; CHECK-NEXT: stratum 1: 3-4 blocks, 2 functions, 2 sampled
+; CHECK:      average pressure: 1.00 +- 0.00
+; CHECK-NEXT: max pressure: 1.75 +- 0.00
+; CHECK-NEXT: live-in per block: 1.48 +- 0.00
+; CHECK-NEXT: highest pressure seen: 4
+; CHECK-NEXT: live-in size distribution (9 blocks):
+; CHECK-NEXT: ==>0 11.1%
+; CHECK-NEXT: ==>1-2 77.8%
+; CHECK-NEXT: ==>3-4 11.1%
@@ -0,0 +1,30 @@
+; REQUIRES: liveness-stream
+; RUN: llvm-as %s -o %t.a.bc
+; RUN: llvm-as %s -o %t.b.bc
+; RUN: echo "not bitcode" > %t.bad.bc
+; RUN: rm -f %t.a.bc.riv %t.b.bc.riv %t.bad.bc.riv %t.missing.bc
+; RUN: not %shlibdir/liveness-stream -batch -j 2 %t.a.bc %t.missing.bc %t.b.bc %t.bad.bc 2>&1 | FileCheck %s --check-prefix=BATCH
+; RUN: FileCheck %s < %t.a.bc.riv
+; RUN: FileCheck %s < %t.b.bc.riv
+; RUN: not ls %t.bad.bc.riv
+
+; Verifies the batch mode of liveness-stream: every input X that can be read
+; gets its RIV in X.riv, a missing or malformed input is reported with its
+; name and counted as failed, and leaves no output behind. Only built with
+; -DLIVENESS_BUILD_STREAM=ON.
+
+define i32 @f(i32 %a) {
+entry:
+  %x = add i32 %a, 1
+  ret i32 %x
+}
+
+; BATCH-DAG: liveness-stream: '{{.*}}missing.bc': {{.*}}
+; BATCH-DAG: liveness-stream: '{{.*}}bad.bc': {{.*}}
+; BATCH: liveness-stream: 4 modules (2 failed) on 2 threads
+
+; CHECK: Reachable Value analysis results
+; CHECK-NEXT: =================================================
+; CHECK-NEXT: {{\[\[}}BasicBlock %entry]]
+; CHECK-NEXT: ==>i32 %a
+; CHECK-NEXT: -------------------------------------------------
@@ -0,0 +1,36 @@
+; REQUIRES: liveness-stream
+; RUN: llvm-as %s -o %t.bc
+; RUN: %shlibdir/liveness-stream %t.bc -o %t.stream 2>&1 | FileCheck %s
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='liveness-dump<output=%t.dump>' -disable-output %t.bc
+; RUN: diff %t.dump %t.stream
+
+; Verifies that the liveness-stream tool, which materializes one function at
+; a time, writes the same RIV as liveness-dump for the whole module. Only
+; built with -DLIVENESS_BUILD_STREAM=ON.
+
+@g = global i32 0
+
+declare void @use(i32)
+
+define i32 @first(i32 %a) {
+entry:
+  %x = add i32 %a, 1
+  br i1 undef, label %left, label %join
+
+left:
+  %y = mul i32 %x, 2
+  call void @use(i32 %y)
+  br label %join
+
+join:
+  ret i32 %x
+}
+
+define i32 @second(i32 %a, i32 %b) {
+entry:
+  %c = call i32 @first(i32 %a)
+  %d = add i32 %c, %b
+  ret i32 %d
+}
+
+; CHECK: liveness-stream: 2 functions, largest 6 instructions
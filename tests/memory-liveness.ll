@@ -0,0 +1,108 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='memory-liveness<threads=2>' -disable-output %s 2>&1 | FileCheck %s
+
+; Verifies per-object memory liveness and dead stores: overwritten stores,
+; stores to a non-escaping alloca read only through a nocapture argument,
+; stores to globals that stay live past the return or a resume, and reads
+; and calls through a select or phi of allocas, which may see either of them.
+
+@g = global i32 0
+
+declare void @use(i32*)
+declare void @readonly_nocap(i32* nocapture readonly)
+declare void @may_throw()
+declare i32 @__gxx_personality_v0(...)
+
+define i32 @f(i1 %c) {
+entry:
+  %a = alloca i32
+  %b = alloca i32
+  store i32 1, i32* %a
+  store i32 2, i32* %a
+  store i32 3, i32* %b
+  store i32 7, i32* @g
+  br i1 %c, label %then, label %else
+then:
+  store i32 4, i32* %b
+  br label %join
+else:
+  call void @readonly_nocap(i32* %b)
+  br label %join
+join:
+  %v = load i32, i32* %a
+  store i32 5, i32* %a
+  ret i32 %v
+}
+
+; CHECK-LABEL: Memory liveness for function f
+; CHECK: {{\[\[}}Object %a]] 3 stores
+; CHECK-NEXT: =>x#0  store i32 1, i32* %a
+; CHECK-NEXT: ==>#1  store i32 2, i32* %a
+; CHECK-NEXT: =>x#2  store i32 5, i32* %a
+; CHECK-NEXT: live into %then: #1
+; CHECK-NEXT: live into %else: #1
+; CHECK-NEXT: live into %join: #1
+; CHECK: {{\[\[}}Object %b]] 2 stores
+; CHECK-NEXT: ==>#0  store i32 3, i32* %b
+; CHECK-NEXT: =>x#1  store i32 4, i32* %b
+; CHECK-NEXT: live into %else: #0
+; CHECK-NEXT: ---
+; CHECK: {{\[\[}}Object @g]] 1 stores
+; CHECK-NEXT: ==>#0  store i32 7, i32* @g
+; CHECK-NEXT: live into %then: #0
+
+define i32 @sel(i1 %c) {
+entry:
+  %a = alloca i32
+  %b = alloca i32
+  store i32 1, i32* %a
+  store i32 2, i32* %b
+  %p = select i1 %c, i32* %a, i32* %b
+  %v = load i32, i32* %p
+  ret i32 %v
+}
+
+; CHECK-LABEL: Memory liveness for function sel
+; CHECK: {{\[\[}}Object %a]] 1 stores
+; CHECK-NEXT: ==>#0  store i32 1, i32* %a
+; CHECK: {{\[\[}}Object %b]] 1 stores
+; CHECK-NEXT: ==>#0  store i32 2, i32* %b
+
+define void @phi_call(i1 %c) {
+entry:
+  %a = alloca i32
+  %b = alloca i32
+  store i32 1, i32* %a
+  store i32 2, i32* %b
+  br i1 %c, label %then, label %join
+then:
+  br label %join
+join:
+  %p = phi i32* [ %a, %entry ], [ %b, %then ]
+  call void @readonly_nocap(i32* %p)
+  ret void
+}
+
+; CHECK-LABEL: Memory liveness for function phi_call
+; CHECK: {{\[\[}}Object %a]] 1 stores
+; CHECK-NEXT: ==>#0  store i32 1, i32* %a
+; CHECK-NEXT: live into %then: #0
+; CHECK-NEXT: live into %join: #0
+; CHECK: {{\[\[}}Object %b]] 1 stores
+; CHECK-NEXT: ==>#0  store i32 2, i32* %b
+; CHECK-NEXT: live into %then: #0
+; CHECK-NEXT: live into %join: #0
+
+define void @unwind() personality i32 (...)* @__gxx_personality_v0 {
+entry:
+  invoke void @may_throw() to label %ok unwind label %lpad
+ok:
+  ret void
+lpad:
+  %lp = landingpad { i8*, i32 } cleanup
+  store i32 3, i32* @g
+  resume { i8*, i32 } %lp
+}
+
+; CHECK-LABEL: Memory liveness for function unwind
+; CHECK: {{\[\[}}Object @g]] 1 stores
+; CHECK-NEXT: ==>#0  store i32 3, i32* @g
@@ -0,0 +1,68 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes=phi-copies -disable-output %s 2>&1 | FileCheck %s
+
+; Verifies the copy estimate for SSA destruction. In @simple the increment
+; coalesces with the induction phi and only the constant needs a copy. In
+; @swap the two phis exchange values on the back edge and interfere, and in
+; @overlap %i is still live after %i.next is defined.
+
+define void @simple(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: Out-of-SSA copy estimate for function simple
+; CHECK-NEXT:  =====
+; CHECK-NEXT:  phis 1, webs 1, copies 1 (naive 3)
+; CHECK-NEXT:  {{\[\[}}Web %i]] copies 1
+
+define i32 @swap(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %a = phi i32 [ 1, %entry ], [ %b, %loop ]
+  %b = phi i32 [ 2, %entry ], [ %a, %loop ]
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+; CHECK-LABEL: Out-of-SSA copy estimate for function swap
+; CHECK-NEXT:  =====
+; CHECK-NEXT:  phis 3, webs 2, copies 5 (naive 9)
+; CHECK-NEXT:  {{\[\[}}Web %a]] copies 4
+; CHECK-NEXT:  ==>  %a = phi
+; CHECK-NEXT:  ==>  %b = phi
+; CHECK-NEXT:  {{\[\[}}Web %i]] copies 1
+
+define i32 @overlap(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %i
+}
+
+; CHECK-LABEL: Out-of-SSA copy estimate for function overlap
+; CHECK-NEXT:  =====
+; CHECK-NEXT:  phis 1, webs 1, copies 2 (naive 3)
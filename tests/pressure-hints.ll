@@ -0,0 +1,56 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes=pressure-hints -S %s 2>&1 | FileCheck %s
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='pressure-hints-bench<repeat=3>' -disable-output %s 2>&1 | FileCheck %s --check-prefix=BENCH
+
+; Verifies that pressure hints are attached to every defined function (the
+; running pressure count includes live-in values and excludes allocas), that
+; functions which already carry hints keep them, and that the benchmark's
+; incremental and naive computations agree.
+
+define i32 @straight(i32 %a, i32 %b) {
+entry:
+  %x = add i32 %a, %b
+  %y = mul i32 %x, %a
+  %z = sub i32 %y, %b
+  ret i32 %z
+}
+
+define i32 @loop(i32 %a, i32 %n) {
+entry:
+  %slot = alloca i32
+  store i32 %a, i32* %slot
+  br label %body
+
+body:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %body ]
+  %v = load i32, i32* %slot
+  %s.next = add i32 %s, %v
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %body, label %exit
+
+exit:
+  ret i32 %s.next
+}
+
+define i32 @annotated(i32 %a) #0 {
+entry:
+  ret i32 %a
+}
+
+declare i32 @external(i32)
+
+; CHECK: define i32 @straight(i32 %a, i32 %b) #[[STRAIGHT:[0-9]+]]
+; CHECK: define i32 @loop(i32 %a, i32 %n) #[[LOOP:[0-9]+]]
+; CHECK: define i32 @annotated(i32 %a) #[[ANNOTATED:[0-9]+]]
+; CHECK: declare i32 @external(i32)
+; CHECK-NOT: liveness-
+; CHECK-DAG: attributes #[[STRAIGHT]] = { "liveness-avg-pressure"="1.50" "liveness-max-pressure"="3" }
+; CHECK-DAG: attributes #[[LOOP]] = { "liveness-avg-pressure"="{{[0-9.]+}}" "liveness-max-pressure"="4" }
+; CHECK-DAG: attributes #[[ANNOTATED]] = { "liveness-avg-pressure"="9.00" "liveness-max-pressure"="9" }
+
+; BENCH: pressure-hints-bench: 3 functions, 5 blocks, 16 instructions, results match (3 runs)
+; BENCH-NEXT: liveness {{[0-9.]+}} ms, hints {{[0-9.]+}} ms, naive hints {{[0-9.]+}} ms
+; BENCH-NEXT: per function {{[0-9.]+}} us, per instruction {{[0-9.]+}} ns
+
+attributes #0 = { "liveness-avg-pressure"="9.00" "liveness-max-pressure"="9" }
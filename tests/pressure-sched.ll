@@ -0,0 +1,132 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='pressure-sched<verify>,print<live-sets>' -S %s -o - 2>%t.err | FileCheck %s --check-prefix=IR
+; RUN: FileCheck %s < %t.err
+
+; Verifies that independent loads are sunk next to their users so that at
+; most two of them are live at a time, that stores, calls and trapping
+; division keep their order, that dbg.value calls move with the instruction
+; before them, and that the preserved live sets match a fresh computation.
+
+define i32 @sink(i32* %p) {
+entry:
+  %pa = getelementptr i32, i32* %p, i64 1
+  %pb = getelementptr i32, i32* %p, i64 2
+  %pc = getelementptr i32, i32* %p, i64 3
+  %pd = getelementptr i32, i32* %p, i64 4
+  %a = load i32, i32* %pa
+  %b = load i32, i32* %pb
+  %c = load i32, i32* %pc
+  %d = load i32, i32* %pd
+  %x = mul i32 %a, 3
+  %y = mul i32 %b, 5
+  %z = mul i32 %c, 7
+  %w = mul i32 %d, 9
+  %s1 = add i32 %x, %y
+  %s2 = add i32 %s1, %z
+  %s3 = add i32 %s2, %w
+  ret i32 %s3
+}
+
+declare void @effect()
+
+define i32 @ordered(i32 %a, i32 %b, i32* %p) {
+entry:
+  %x = add i32 %a, 1
+  %y = add i32 %b, 2
+  call void @effect()
+  %d = sdiv i32 %a, %b
+  store i32 %d, i32* %p
+  %s = add i32 %x, %y
+  ret i32 %s
+}
+
+define i32 @debug(i32* %p) !dbg !6 {
+entry:
+  %pa = getelementptr i32, i32* %p, i64 1
+  %pb = getelementptr i32, i32* %p, i64 2
+  %pc = getelementptr i32, i32* %p, i64 3
+  %pd = getelementptr i32, i32* %p, i64 4
+  %a = load i32, i32* %pa
+  call void @llvm.dbg.value(metadata i32 %a, metadata !9, metadata !DIExpression()), !dbg !11
+  %b = load i32, i32* %pb
+  call void @llvm.dbg.value(metadata i32 %b, metadata !12, metadata !DIExpression()), !dbg !11
+  %c = load i32, i32* %pc
+  call void @llvm.dbg.value(metadata i32 %c, metadata !13, metadata !DIExpression()), !dbg !11
+  %d = load i32, i32* %pd
+  call void @llvm.dbg.value(metadata i32 %d, metadata !14, metadata !DIExpression()), !dbg !11
+  %x = mul i32 %a, 3
+  %y = mul i32 %b, 5
+  %z = mul i32 %c, 7
+  %w = mul i32 %d, 9
+  %s1 = add i32 %x, %y
+  %s2 = add i32 %s1, %z
+  %s3 = add i32 %s2, %w
+  ret i32 %s3
+}
+
+declare void @llvm.dbg.value(metadata, metadata, metadata)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "test", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "debug.c", directory: "/")
+!3 = !{i32 7, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!6 = distinct !DISubprogram(name: "debug", scope: !1, file: !1, line: 1, type: !7, scopeLine: 1, unit: !0)
+!7 = !DISubroutineType(types: !8)
+!8 = !{!10}
+!9 = !DILocalVariable(name: "a", scope: !6, file: !1, line: 1, type: !10)
+!10 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
+!11 = !DILocation(line: 1, column: 5, scope: !6)
+!12 = !DILocalVariable(name: "b", scope: !6, file: !1, line: 1, type: !10)
+!13 = !DILocalVariable(name: "c", scope: !6, file: !1, line: 1, type: !10)
+!14 = !DILocalVariable(name: "d", scope: !6, file: !1, line: 1, type: !10)
+
+; IR-LABEL: define i32 @sink
+; IR-NEXT: entry:
+; IR-NEXT: %pa = getelementptr i32, i32* %p, i64 1
+; IR-NEXT: %a = load i32, i32* %pa
+; IR-NEXT: %pb = getelementptr i32, i32* %p, i64 2
+; IR-NEXT: %b = load i32, i32* %pb
+; IR-NEXT: %x = mul i32 %a, 3
+; IR-NEXT: %y = mul i32 %b, 5
+; IR-NEXT: %s1 = add i32 %x, %y
+; IR-NEXT: %pc = getelementptr i32, i32* %p, i64 3
+; IR-NEXT: %c = load i32, i32* %pc
+; IR-NEXT: %z = mul i32 %c, 7
+; IR-NEXT: %s2 = add i32 %s1, %z
+; IR-NEXT: %pd = getelementptr i32, i32* %p, i64 4
+; IR-NEXT: %d = load i32, i32* %pd
+; IR-NEXT: %w = mul i32 %d, 9
+; IR-NEXT: %s3 = add i32 %s2, %w
+; IR-NEXT: ret i32 %s3
+
+; IR-LABEL: define i32 @ordered
+; IR: call void @effect()
+; IR-NEXT: %d = sdiv i32 %a, %b
+; IR-NEXT: store i32 %d, i32* %p
+
+; IR-LABEL: define i32 @debug
+; IR:      %a = load i32, i32* %pa
+; IR-NEXT: call void @llvm.dbg.value(metadata i32 %a
+; IR-NEXT: %pb = getelementptr i32, i32* %p, i64 2
+; IR-NEXT: %b = load i32, i32* %pb
+; IR-NEXT: call void @llvm.dbg.value(metadata i32 %b
+; IR-NEXT: %x = mul i32 %a, 3
+; IR:      %c = load i32, i32* %pc
+; IR-NEXT: call void @llvm.dbg.value(metadata i32 %c
+; IR:      %d = load i32, i32* %pd
+; IR-NEXT: call void @llvm.dbg.value(metadata i32 %d
+; IR-NEXT: %w = mul i32 %d, 9
+; IR-NEXT: %s3 = add i32 %s2, %w
+; IR-NEXT: ret i32 %s3
+
+; CHECK: Pressure scheduling for function sink
+; CHECK: {{\[\[}}BasicBlock %entry]] peak 4 -> 3
+; CHECK-NEXT: rescheduled 1 of 1 blocks, peak pressure 4 -> 3
+; CHECK-NEXT: live sets verified
+; CHECK: Pressure scheduling for function ordered
+; CHECK: live sets verified
+; CHECK: Pressure scheduling for function debug
+; CHECK: {{\[\[}}BasicBlock %entry]] peak 4 -> 3
+; CHECK: live sets verified
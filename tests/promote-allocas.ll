@@ -0,0 +1,143 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes=promote-allocas -S %s 2>&1 | FileCheck %s
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes=promote-bench -disable-output %s 2>&1 | FileCheck %s --check-prefix=BENCH
+
+; Verifies that allocas are promoted with phis only where they are live: %t
+; is stored on both sides of the diamond but never read, so it gets none. A
+; block that loads before it stores is live-in whatever the use-list order,
+; and dbg.declares become dbg.values as with mem2reg.
+
+; CHECK-LABEL: Alloca promotion for function diamond
+; CHECK: promoted 2 allocas, inserted 1 phis
+; CHECK-LABEL: Alloca promotion for function loop
+; CHECK: promoted 2 allocas, inserted 2 phis
+; CHECK-LABEL: Alloca promotion for function join_reload
+; CHECK: promoted 1 allocas, inserted 1 phis
+; CHECK-LABEL: Alloca promotion for function dbg
+; CHECK: promoted 1 allocas, inserted 1 phis
+
+; CHECK-LABEL: define i32 @diamond
+; CHECK-NOT: alloca
+; CHECK: join:
+; CHECK-NEXT: %x1 = phi i32 [ %a, %else ], [ %b, %then ]
+; CHECK-NEXT: ret i32 %x1
+
+; CHECK-LABEL: define i32 @loop
+; CHECK: header:
+; CHECK-NEXT: %s2 = phi i32 [ 0, %entry ], [ %add, %body ]
+; CHECK-NEXT: %i1 = phi i32 [ 0, %entry ], [ %inc, %body ]
+; CHECK: exit:
+; CHECK-NEXT: ret i32 %s2
+
+; CHECK-LABEL: define i32 @join_reload
+; CHECK: join:
+; CHECK-NEXT: %x1 = phi i32 [ %a, %entry ], [ %b, %then ]
+; CHECK-NEXT: %s = add i32 %x1, 5
+
+; CHECK-LABEL: define i32 @dbg
+; CHECK-NOT: dbg.declare
+; CHECK: call void @llvm.dbg.value(metadata i32 %a, metadata [[VAR:![0-9]+]]
+; CHECK: call void @llvm.dbg.value(metadata i32 %b, metadata [[VAR]]
+; CHECK: %x1 = phi i32 [ %a, %entry ], [ %b, %then ]
+; CHECK-NEXT: call void @llvm.dbg.value(metadata i32 %x1, metadata [[VAR]]
+
+; BENCH: promote-bench: 4 functions, 6 allocas (1 runs)
+; BENCH-NEXT: live-in placement {{.*}} ms, 5 phis
+; BENCH-NEXT: PromoteMemToReg {{.*}} ms, 5 phis
+
+define i32 @diamond(i1 %c, i32 %a, i32 %b) {
+entry:
+  %x = alloca i32
+  %t = alloca i32
+  store i32 %a, i32* %x
+  store i32 0, i32* %t
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 %b, i32* %x
+  store i32 1, i32* %t
+  br label %join
+
+else:
+  store i32 2, i32* %t
+  br label %join
+
+join:
+  %r = load i32, i32* %x
+  ret i32 %r
+}
+
+define i32 @loop(i32 %n) {
+entry:
+  %i = alloca i32
+  %s = alloca i32
+  store i32 0, i32* %i
+  store i32 0, i32* %s
+  br label %header
+
+header:
+  %iv = load i32, i32* %i
+  %cmp = icmp slt i32 %iv, %n
+  br i1 %cmp, label %body, label %exit
+
+body:
+  %sv = load i32, i32* %s
+  %add = add i32 %sv, %iv
+  store i32 %add, i32* %s
+  %inc = add i32 %iv, 1
+  store i32 %inc, i32* %i
+  br label %header
+
+exit:
+  %res = load i32, i32* %s
+  ret i32 %res
+}
+
+define i32 @join_reload(i1 %c, i32 %a, i32 %b) {
+entry:
+  %x = alloca i32
+  store i32 %a, i32* %x
+  br i1 %c, label %then, label %join
+
+then:
+  store i32 %b, i32* %x
+  br label %join
+
+join:
+  %r0 = load i32, i32* %x
+  store i32 5, i32* %x
+  %r1 = load i32, i32* %x
+  %s = add i32 %r0, %r1
+  ret i32 %s
+}
+
+define i32 @dbg(i1 %c, i32 %a, i32 %b) !dbg !6 {
+entry:
+  %x = alloca i32, align 4
+  call void @llvm.dbg.declare(metadata i32* %x, metadata !9, metadata !DIExpression()), !dbg !11
+  store i32 %a, i32* %x, align 4
+  br i1 %c, label %then, label %join
+
+then:
+  store i32 %b, i32* %x, align 4
+  br label %join
+
+join:
+  %r = load i32, i32* %x, align 4
+  ret i32 %r
+}
+
+declare void @llvm.dbg.declare(metadata, metadata, metadata)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "test", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "dbg.c", directory: "/")
+!3 = !{i32 7, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!6 = distinct !DISubprogram(name: "dbg", scope: !1, file: !1, line: 1, type: !7, scopeLine: 1, unit: !0)
+!7 = !DISubroutineType(types: !8)
+!8 = !{!10}
+!9 = !DILocalVariable(name: "x", scope: !6, file: !1, line: 1, type: !10)
+!10 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
+!11 = !DILocation(line: 1, column: 5, scope: !6)
@@ -0,0 +1,63 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='remat-candidates<budget=4>' -disable-output %s 2>&1 | FileCheck %s
+
+; Verifies that cheap live-through values whose operands stay live (%x1,
+; %gep) are reported for the high-pressure loop, while loads and values whose
+; operands would have to be kept alive (%x2) are not. In @dies, %c is live
+; into %exit but dies before the use of %x3, so %x3 is not a candidate.
+
+@g = global [16 x i32] zeroinitializer
+
+define i32 @foo(i32 %a, i32 %b, i32* %p, i32 %n) {
+entry:
+  %x1 = add i32 %a, 1
+  %x2 = mul i32 %b, 3
+  %ld = load i32, i32* %p
+  %gep = getelementptr [16 x i32], [16 x i32]* @g, i32 0, i32 4
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %t = add i32 %acc, %x2
+  %acc.next = add i32 %t, %ld
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %r1 = add i32 %acc.next, %x1
+  %r2 = add i32 %r1, %a
+  store i32 %r2, i32* %gep
+  ret i32 %r2
+}
+
+; CHECK-LABEL: Rematerialization candidates for function foo (register budget 4)
+; CHECK:       BasicBlock %loop]] pressure 9 -> 7
+; CHECK-NEXT:  ==>  %x1 = add i32 %a, 1
+; CHECK-NEXT:  ==>  %gep = getelementptr [16 x i32], [16 x i32]* @g, i32 0, i32 4
+; CHECK-NEXT:  ----
+; CHECK-NOT:   BasicBlock %exit
+
+define i32 @dies(i32 %a, i32 %b, i32 %c, i32 %n) {
+entry:
+  %x3 = add i32 %c, 7
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %t = add i32 %acc, %a
+  %acc.next = add i32 %t, %b
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %r1 = add i32 %acc.next, %c
+  %r2 = add i32 %r1, %x3
+  ret i32 %r2
+}
+
+; CHECK-LABEL: Rematerialization candidates for function dies (register budget 4)
+; CHECK:       BasicBlock %loop]] pressure 8 -> 8
+; CHECK-NEXT:  ----
@@ -0,0 +1,13 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='riv-fuzz<runs=50;blocks=24>' -disable-output %s 2>&1 | FileCheck %s
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='riv-fuzz<seed=7;runs=50;blocks=40;irreducible;invokes>' -disable-output %s 2>&1 | FileCheck %s
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='riv-fuzz<seed=11;runs=50;blocks=24;irreducible;unreachable;threads=2>' -disable-output %s 2>&1 | FileCheck %s
+
+; Verifies that on random reducible and irreducible functions (with phis,
+; switches, invokes and unreachable blocks) buildRIV agrees with its
+; reference and the region engine, sequential or on two threads, with the
+; flat one. The input module is not used.
+
+; CHECK-NOT: riv-fuzz: seed
+; CHECK: riv-fuzz: 50 functions, {{[0-9]+}} blocks, {{[0-9]+}} instructions, 0 mismatches
+; CHECK-NEXT: buildRIV
+; CHECK-NEXT: flat
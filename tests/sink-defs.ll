@@ -0,0 +1,78 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='sink-defs<verify>,print<live-sets>' -S %s -o - 2>%t.err | FileCheck %s --check-prefix=IR
+; RUN: FileCheck %s < %t.err
+
+; Verifies that definitions used only in a distant block are sunk to it
+; (a chain of them, users first) when their operands are live there anyway,
+; that sinking which would extend operand live ranges or enter a loop is not
+; done, and that the incrementally updated live sets match a fresh
+; computation and are the ones later passes see.
+
+define i32 @cold(i32 %a, i32 %b, i32 %p, i32 %q, i1 %c) {
+entry:
+  %x = add i32 %a, %b
+  %y = mul i32 %x, 7
+  %z = sub i32 %p, %q
+  br label %hot
+
+hot:
+  %h = mul i32 %p, %q
+  br i1 %c, label %rare, label %exit
+
+rare:
+  %s = add i32 %y, %a
+  %t = add i32 %s, %b
+  %u = add i32 %t, %z
+  br label %exit
+
+exit:
+  %r = phi i32 [ %h, %hot ], [ %u, %rare ]
+  ret i32 %r
+}
+
+define i32 @loop(i32 %a, i32 %n) {
+entry:
+  %x = mul i32 %a, 3
+  br label %body
+
+body:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %body ]
+  %s.next = add i32 %s, %x
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %body, label %exit
+
+exit:
+  ret i32 %s.next
+}
+
+; IR-LABEL: define i32 @cold
+; IR-NEXT: entry:
+; IR-NEXT: %z = sub i32 %p, %q
+; IR-NEXT: br label %hot
+; IR: rare:
+; IR-NEXT: %x = add i32 %a, %b
+; IR-NEXT: %y = mul i32 %x, 7
+; IR-NEXT: %s = add i32 %y, %a
+; IR-LABEL: define i32 @loop
+; IR-NEXT: entry:
+; IR-NEXT: %x = mul i32 %a, 3
+
+; CHECK: Definition sinking for function cold
+; CHECK-NEXT: =================================================
+; CHECK-NEXT: ==>  %y = mul i32 %x, 7
+; CHECK-NEXT:    %entry -> %rare
+; CHECK-NEXT: ==>  %x = add i32 %a, %b
+; CHECK-NEXT:    %entry -> %rare
+; CHECK-NEXT: sunk 2 definitions, peak pressure 7 -> 6, live-in values 16 -> 14
+; CHECK-NEXT: live sets verified
+; CHECK: Live sets for function cold
+; CHECK: {{\[\[}}BasicBlock %hot]] max pressure 6
+; CHECK-NEXT: live-in:  %a %b %p %q %c %z
+; CHECK-NEXT: live-out: %a %b %z %h
+; CHECK-NEXT: {{\[\[}}BasicBlock %rare]] max pressure 4
+; CHECK-NEXT: live-in:  %a %b %z
+; CHECK: Definition sinking for function loop
+; CHECK-NEXT: =================================================
+; CHECK-NEXT: sunk 0 definitions
+; CHECK-NEXT: live sets verified
@@ -0,0 +1,41 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='spill-cost<budget=4>' -disable-output %s 2>&1 | FileCheck %s
+
+; Verifies that values live through a loop which exceeds the register budget
+; are picked as spill candidates, and that functions are ranked by their
+; frequency-weighted cost.
+
+define i32 @cold(i32 %a) {
+  ret i32 %a
+}
+
+define i32 @hot(i32 %a, i32 %b, i32 %c, i32 %n) {
+entry:
+  %x1 = add i32 %a, 1
+  %x2 = add i32 %b, 2
+  %x3 = add i32 %c, 3
+  %x4 = mul i32 %a, %b
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %t = add i32 %acc, %x1
+  %u = add i32 %t, %x2
+  %acc.next = add i32 %u, %i
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %r1 = add i32 %acc.next, %x3
+  %r2 = add i32 %r1, %x4
+  ret i32 %r2
+}
+
+; CHECK:      Spill cost estimate (register budget 4)
+; CHECK:      1     hot {{.*}}       4       2       8
+; CHECK-NEXT:       spill %n
+; CHECK-NEXT:       spill %x1
+; CHECK-NEXT:       spill %x3 (cost 2.00)
+; CHECK-NEXT:       spill %x4 (cost 2.00)
+; CHECK-NEXT: 2     cold {{.*}}0.00       0       0       1
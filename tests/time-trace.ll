@@ -0,0 +1,36 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes='function(liveness),liveness-dump<threads=2;trace-granularity=0>' -time-trace -time-trace-granularity=0 -time-trace-file=%t.json -disable-output %s 2>/dev/null
+; RUN: %python -c "import json, sys; [print('main' if e['tid'] == e['pid'] else 'worker', e['name'], e.get('args', {}).get('detail', '')) for e in json.load(open(sys.argv[1]))['traceEvents'] if e['ph'] == 'X' and not e['name'].startswith('Total')]" %t.json | FileCheck %s
+
+; Verifies that '-time-trace' records a span for every function and every
+; phase of the RIV, on the main thread for 'liveness' and on the worker
+; threads for 'liveness-dump'.
+
+define i32 @first(i32 %a, i32 %b) {
+entry:
+  %add = add i32 %a, %b
+  br label %exit
+
+exit:
+  ret i32 %add
+}
+
+define i32 @second(i32 %c) {
+entry:
+  %mul = mul i32 %c, 2
+  ret i32 %mul
+}
+
+; CHECK-DAG: main liveness first
+; CHECK-DAG: main liveness second
+; CHECK-DAG: main RIV first
+; CHECK-DAG: main RIV defs
+; CHECK-DAG: main RIV entry
+; CHECK-DAG: main RIV propagation
+; CHECK-DAG: main RIV printing
+; CHECK-DAG: worker liveness-dump function first
+; CHECK-DAG: worker liveness-dump function second
+; CHECK-DAG: worker RIV second
+; CHECK-DAG: worker RIV defs
+; CHECK-DAG: worker RIV entry
+; CHECK-DAG: worker RIV propagation
+; CHECK-DAG: worker RIV printing
@@ -0,0 +1,68 @@
+; RUN: opt -load-pass-plugin %shlibdir/libLiveness%shlibext -passes=vector-lanes -disable-output %s 2>&1 | FileCheck %s
+
+; Verifies that demanded lanes are followed backwards through extracts,
+; inserts, a shuffle and a loop phi: only lanes 0 and 2 of the wide values
+; are ever read, so they narrow to a single 128-bit register, while the
+; 4-lane shuffle result is already a single register. In @span the registers
+; cover every lane from the lowest to the highest demanded one, and a live
+; value with no demanded lanes still takes a register.
+
+define float @kernel(<16 x float>* %p, <16 x float> %b, i32 %n) {
+entry:
+  %v = load <16 x float>, <16 x float>* %p
+  %w = fmul <16 x float> %v, %b
+  %lo = shufflevector <16 x float> %w, <16 x float> undef, <4 x i32> <i32 0, i32 1, i32 2, i32 3>
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi <16 x float> [ %w, %entry ], [ %acc.next, %loop ]
+  %acc.next = fadd <16 x float> %acc, %v
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %ins = insertelement <16 x float> %acc.next, float 0.0, i32 1
+  %e0 = extractelement <16 x float> %ins, i32 0
+  %e1 = extractelement <16 x float> %ins, i32 1
+  %e2 = extractelement <4 x float> %lo, i32 2
+  %s = fadd float %e0, %e1
+  %r = fadd float %s, %e2
+  ret float %r
+}
+
+; CHECK-LABEL: Vector lane liveness for function kernel (128-bit registers)
+; CHECK: vector values 7, narrowable 6
+; CHECK: ==><16 x float> %b
+; CHECK-NEXT: lanes 2/16, registers 4 -> 1
+; CHECK: %w = fmul
+; CHECK-NEXT: lanes 2/16, registers 4 -> 1
+; CHECK: %acc = phi
+; CHECK-NEXT: lanes 1/16, registers 4 -> 1
+; CHECK: %ins = insertelement
+; CHECK-NEXT: lanes 2/16, registers 4 -> 1
+; CHECK-NOT: %lo = shufflevector
+; CHECK: BasicBlock %entry]] vector registers 9 -> 3
+; CHECK: BasicBlock %loop]] vector registers 9 -> 3
+; CHECK: BasicBlock %exit]] vector registers 5 -> 2
+
+define float @span(<16 x float> %a, <16 x float> %u) {
+entry:
+  %x = fmul <16 x float> %a, %a
+  %e0 = extractelement <16 x float> %x, i32 0
+  %e8 = extractelement <16 x float> %x, i32 8
+  %y = insertelement <16 x float> %u, float %e0, i32 0
+  %e = extractelement <16 x float> %y, i32 0
+  %s = fadd float %e0, %e8
+  %r = fadd float %s, %e
+  ret float %r
+}
+
+; CHECK-LABEL: Vector lane liveness for function span (128-bit registers)
+; CHECK: vector values 4, narrowable 4
+; CHECK: ==><16 x float> %a
+; CHECK-NEXT: lanes 2/16, registers 4 -> 3
+; CHECK: ==><16 x float> %u
+; CHECK-NEXT: lanes 0/16, registers 4 -> 1
+; CHECK: BasicBlock %entry]] vector registers 8 -> 4